@@ -0,0 +1,199 @@
+#include "RMGAcceptanceGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "Randomize.hh"
+#include "G4Threading.hh"
+
+#include "RMGLog.hh"
+
+namespace {
+
+  struct GridCacheHeader {
+    char          magic[8];  // "RMGGRID\0"
+    std::uint32_t version;
+    std::int32_t  n[3];
+    std::uint64_t key;
+  };
+
+  const char* kGridMagic = "RMGGRID";
+  const std::uint32_t kGridVersion = 1;
+}
+
+std::mutex RMGAcceptanceGrid::fSharedGridsMutex;
+std::map<std::uint64_t, std::shared_ptr<RMGAcceptanceGrid::SharedGrid>> RMGAcceptanceGrid::fSharedGrids;
+
+std::uint64_t RMGAcceptanceGrid::Hash(const std::string& data, std::uint64_t seed) {
+  auto h = seed;
+  for (const auto& c : data) {
+    h ^= static_cast<std::uint8_t>(c);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+void RMGAcceptanceGrid::Build(const G4ThreeVector& pmin, const G4ThreeVector& pmax, G4int resolution,
+    const Classifier& classifier, std::uint64_t key, G4String cache_dir) {
+
+  fCells.clear();
+  fNInside = 0;
+
+  if (resolution <= 0) RMGLog::Out(RMGLog::fatal, "Acceptance grid resolution must be positive");
+
+  auto extent = pmax - pmin;
+  auto longest = std::max({extent.x(), extent.y(), extent.z()});
+  if (longest <= 0) RMGLog::Out(RMGLog::fatal, "Cannot build acceptance grid over an empty box");
+
+  for (G4int i = 0; i < 3; ++i) {
+    fN[i] = std::max(1, static_cast<G4int>(std::ceil(resolution * extent[i] / longest)));
+  }
+  fMin = pmin;
+  fCellSize = G4ThreeVector(extent.x() / fN[0], extent.y() / fN[1], extent.z() / fN[2]);
+
+  size_t n_cells = static_cast<size_t>(fN[0]) * fN[1] * fN[2];
+  if (n_cells > std::numeric_limits<std::uint32_t>::max()) {
+    RMGLog::Out(RMGLog::fatal, "Acceptance grid resolution too high (", n_cells, " cells)");
+  }
+
+  // the grid shape is part of the key
+  key = Hash(std::to_string(fN[0]) + "x" + std::to_string(fN[1]) + "x" + std::to_string(fN[2]), key);
+
+  G4String cache_file;
+  if (!cache_dir.empty()) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(key));
+    cache_file = cache_dir + "/rmg-grid-" + buf + ".bin";
+  }
+
+  std::vector<std::uint8_t> types;
+  if (cache_file.empty() or !this->ReadCache(cache_file, key, types)) {
+    types.resize(n_cells);
+    auto half_diagonal = 0.5 * fCellSize.mag();
+    for (G4int k = 0; k < fN[2]; ++k) {
+      for (G4int j = 0; j < fN[1]; ++j) {
+        for (G4int i = 0; i < fN[0]; ++i) {
+          auto center = fMin + G4ThreeVector((i + 0.5) * fCellSize.x(),
+              (j + 0.5) * fCellSize.y(), (k + 0.5) * fCellSize.z());
+          types[i + fN[0] * (j + fN[1] * static_cast<size_t>(k))] = classifier(center, half_diagonal);
+        }
+      }
+    }
+    if (!cache_file.empty()) this->WriteCache(cache_file, key, types);
+  }
+
+  for (size_t i = 0; i < n_cells; ++i) {
+    if (types[i] == kInsideCell) fCells.push_back(i);
+  }
+  fNInside = fCells.size();
+  for (size_t i = 0; i < n_cells; ++i) {
+    if (types[i] == kBoundaryCell) fCells.push_back(i);
+  }
+
+  RMGLog::OutFormat(RMGLog::debug, "Acceptance grid %dx%dx%d: %zu inside, %zu boundary cells",
+      fN[0], fN[1], fN[2], this->GetNInsideCells(), this->GetNBoundaryCells());
+}
+
+std::shared_ptr<const RMGAcceptanceGrid> RMGAcceptanceGrid::BuildShared(const G4ThreeVector& pmin,
+    const G4ThreeVector& pmax, G4int resolution, const Classifier& classifier,
+    std::uint64_t key, G4String cache_dir) {
+
+  std::ostringstream ss;
+  ss.precision(17);
+  ss << resolution << " " << pmin << " " << pmax;
+  auto shared_key = Hash(ss.str(), key);
+
+  std::shared_ptr<SharedGrid> shared;
+  {
+    std::lock_guard<std::mutex> lock(fSharedGridsMutex);
+    auto& entry = fSharedGrids[shared_key];
+    if (!entry) entry = std::make_shared<SharedGrid>();
+    shared = entry;
+  }
+
+  // the first thread builds the grid while holding its lock, the others
+  // wait and reuse it. Classification is done once per process
+  std::lock_guard<std::mutex> lock(shared->mutex);
+  if (shared->grid) {
+    RMGLog::Out(RMGLog::debug, "Reusing shared acceptance grid");
+    return shared->grid;
+  }
+
+  auto grid = std::make_shared<RMGAcceptanceGrid>();
+  grid->Build(pmin, pmax, resolution, classifier, key, cache_dir);
+  shared->grid = grid;
+  return grid;
+}
+
+G4ThreeVector RMGAcceptanceGrid::Sample(G4bool& needs_check) const {
+
+  // all cells have the same volume, a uniform choice is enough
+  auto idx = std::min(static_cast<size_t>(G4UniformRand() * fCells.size()), fCells.size() - 1);
+  needs_check = idx >= fNInside;
+
+  auto cell = fCells[idx];
+  auto i = cell % fN[0];
+  auto j = (cell / fN[0]) % fN[1];
+  auto k = cell / fN[0] / fN[1];
+
+  return fMin + G4ThreeVector((i + G4UniformRand()) * fCellSize.x(),
+      (j + G4UniformRand()) * fCellSize.y(), (k + G4UniformRand()) * fCellSize.z());
+}
+
+G4bool RMGAcceptanceGrid::ReadCache(const G4String& file_name, std::uint64_t key,
+    std::vector<std::uint8_t>& types) const {
+
+  std::ifstream file(file_name, std::ios::binary);
+  if (!file.is_open()) return false;
+
+  GridCacheHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file or std::strncmp(header.magic, kGridMagic, sizeof(header.magic)) != 0 or
+      header.version != kGridVersion or header.key != key or
+      header.n[0] != fN[0] or header.n[1] != fN[1] or header.n[2] != fN[2]) {
+    RMGLog::Out(RMGLog::warning, "Ignoring invalid acceptance grid cache file '", file_name, "'");
+    return false;
+  }
+
+  types.resize(static_cast<size_t>(fN[0]) * fN[1] * fN[2]);
+  file.read(reinterpret_cast<char*>(types.data()), types.size());
+  if (!file) {
+    RMGLog::Out(RMGLog::warning, "Ignoring truncated acceptance grid cache file '", file_name, "'");
+    return false;
+  }
+
+  RMGLog::Out(RMGLog::detail, "Acceptance grid read from cache file '", file_name, "'");
+  return true;
+}
+
+void RMGAcceptanceGrid::WriteCache(const G4String& file_name, std::uint64_t key,
+    const std::vector<std::uint8_t>& types) const {
+
+  GridCacheHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::strncpy(header.magic, kGridMagic, sizeof(header.magic));
+  header.version = kGridVersion;
+  std::copy(fN, fN + 3, header.n);
+  header.key = key;
+
+  // several threads might be building the same grid, the rename makes sure
+  // that readers never see a partially written file
+  auto tmp_name = file_name + ".tmp" + std::to_string(G4Threading::G4GetThreadId());
+  std::ofstream file(tmp_name, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(types.data()), types.size());
+  file.close();
+
+  if (!file or std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+    std::remove(tmp_name.c_str());
+    RMGLog::Out(RMGLog::warning, "Could not write acceptance grid cache file '", file_name, "'");
+  }
+  else RMGLog::Out(RMGLog::detail, "Acceptance grid written to cache file '", file_name, "'");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,68 @@
+#include "RMGAliasTable.hh"
+
+#include "Randomize.hh"
+
+#include "RMGLog.hh"
+
+void RMGAliasTable::Build(const std::vector<G4double>& weights) {
+
+  this->clear();
+  if (weights.empty()) return;
+
+  auto n = weights.size();
+
+  for (const auto& w : weights) {
+    if (w < 0) RMGLog::Out(RMGLog::fatal, "Negative weight (", w, ") passed to alias table");
+    fTotalWeight += w;
+  }
+  if (fTotalWeight <= 0) {
+    RMGLog::Out(RMGLog::error, "Alias table built from null weights, will sample uniformly");
+  }
+
+  fProbabilities.resize(n);
+  fAliases.resize(n);
+
+  // scale weights such that their average is 1, then split them in the ones
+  // that under- and overfill their bin
+  std::vector<G4double> scaled(n);
+  std::vector<size_t> small, large;
+  for (size_t i = 0; i < n; ++i) {
+    scaled[i] = fTotalWeight > 0 ? weights[i] * n / fTotalWeight : 1;
+    if (scaled[i] < 1) small.push_back(i);
+    else large.push_back(i);
+  }
+
+  // fill each underfull bin with probability mass from an overfull one
+  while (!small.empty() and !large.empty()) {
+    auto s = small.back(); small.pop_back();
+    auto l = large.back(); large.pop_back();
+
+    fProbabilities[s] = scaled[s];
+    fAliases[s] = l;
+
+    scaled[l] = (scaled[l] + scaled[s]) - 1;
+    if (scaled[l] < 1) small.push_back(l);
+    else large.push_back(l);
+  }
+
+  // what is left is full up to rounding errors
+  for (auto i : large) { fProbabilities[i] = 1; fAliases[i] = i; }
+  for (auto i : small) { fProbabilities[i] = 1; fAliases[i] = i; }
+}
+
+size_t RMGAliasTable::Sample() const {
+  return this->Sample(G4UniformRand());
+}
+
+size_t RMGAliasTable::Sample(G4double u) const {
+
+  // one uniform number is enough: the integer part selects the bin, the
+  // fractional part decides between the bin and its alias
+  auto x = u * fProbabilities.size();
+  auto i = static_cast<size_t>(x);
+  if (i >= fProbabilities.size()) i = fProbabilities.size() - 1;
+
+  return (x - i) < fProbabilities[i] ? i : fAliases[i];
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
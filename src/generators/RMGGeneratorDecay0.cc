@@ -1,13 +1,226 @@
 #include "RMGGeneratorDecay0.hh"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Gamma.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Alpha.hh"
+#include "G4Neutron.hh"
+#include "G4Proton.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "bxdecay0/particle.h"
+#include "bxdecay0/decay0_generator.h"
+
+#include "RMGGeneratorDecay0Messenger.hh"
+#include "RMGPrimaryBatch.hh"
+#include "RMGRun.hh"
+#include "RMGLog.hh"
+
+struct RMGGeneratorDecay0::SharedGenerator {
+  std::mutex mutex;
+  std::unique_ptr<bxdecay0::decay0_generator> generator;
+};
+
+namespace {
+
+  const G4ParticleDefinition* GetParticleDefinition(const bxdecay0::particle& p) {
+    switch (p.get_code()) {
+      case bxdecay0::GAMMA    : return G4Gamma::Definition();
+      case bxdecay0::ELECTRON : return G4Electron::Definition();
+      case bxdecay0::POSITRON : return G4Positron::Definition();
+      case bxdecay0::ALPHA    : return G4Alpha::Definition();
+      case bxdecay0::NEUTRON  : return G4Neutron::Definition();
+      case bxdecay0::PROTON   : return G4Proton::Definition();
+      default : RMGLog::Out(RMGLog::fatal, "BxDecay0 particle with code ", p.get_code(), " not supported");
+    }
+    return nullptr;
+  }
+}
+
+double RMGGeneratorDecay0::Random::operator()() {
+  return G4UniformRand();
+}
+
 RMGGeneratorDecay0::RMGGeneratorDecay0() :
-  RMGVGenerator("Decay0") {
+  RMGVGenerator("Decay0"),
+  fDecayCategory(DecayCategory::kBackground),
+  fNuclide(""),
+  fDoubleBetaMode(bxdecay0::DBDMODE_1),
+  fDoubleBetaLevel(0),
+  fEnergyWindowMin(-1),
+  fEnergyWindowMax(-1),
+  fEventWeight(1),
+  fRunNGenerated(nullptr),
+  fRunSumOfWeights(nullptr) {
+
+  fG4Messenger = std::unique_ptr<RMGGeneratorDecay0Messenger>(new RMGGeneratorDecay0Messenger(this));
+  RMGRun::RegisterSummary("Decay0", &RMGGeneratorDecay0::PrintRunSummary);
+}
+
+RMGGeneratorDecay0::~RMGGeneratorDecay0() = default;
+
+G4bool RMGGeneratorDecay0::HasEnergyWindow() const {
+  return fEnergyWindowMin >= 0 or fEnergyWindowMax >= 0;
+}
+
+void RMGGeneratorDecay0::Reset() {
+  fSharedGenerator.reset();
+  fEventWeight = 1;
+}
+
+void RMGGeneratorDecay0::Initialize() {
+
+  if (fNuclide.empty()) RMGLog::Out(RMGLog::fatal, "No nuclide specified for the Decay0 generator");
+
+  std::ostringstream key;
+  key << fDecayCategory << " " << fNuclide << " " << fDoubleBetaMode << " " << fDoubleBetaLevel
+    << " " << fEnergyWindowMin << " " << fEnergyWindowMax;
+  {
+    // one generator per configuration, kept for the whole job
+    static std::mutex shared_generators_mutex;
+    static std::map<G4String, std::shared_ptr<SharedGenerator>> shared_generators;
+
+    std::lock_guard<std::mutex> lock(shared_generators_mutex);
+    auto& shared = shared_generators[key.str()];
+    if (!shared) shared = std::make_shared<SharedGenerator>();
+    fSharedGenerator = shared;
+  }
+
+  // the other threads with the same configuration wait for the tables
+  std::lock_guard<std::mutex> lock(fSharedGenerator->mutex);
+  if (fSharedGenerator->generator) return;
 
-  fDecay0G4Generator = std::unique_ptr<bxdecay0_g4::PrimaryGeneratorAction>(new bxdecay0_g4::PrimaryGeneratorAction(0));
+  auto generator = std::unique_ptr<bxdecay0::decay0_generator>(new bxdecay0::decay0_generator());
+  generator->set_decay_isotope(fNuclide);
+
+  if (fDecayCategory == DecayCategory::kBackground) {
+    if (this->HasEnergyWindow()) {
+      RMGLog::Out(RMGLog::fatal, "Energy window is supported only for double beta decays");
+    }
+    generator->set_decay_category(bxdecay0::decay0_generator::DECAY_CATEGORY_BACKGROUND);
+  }
+  else {
+    generator->set_decay_category(bxdecay0::decay0_generator::DECAY_CATEGORY_DBD);
+    generator->set_decay_dbd_level(fDoubleBetaLevel);
+    generator->set_decay_dbd_mode(static_cast<bxdecay0::dbd_mode_type>(fDoubleBetaMode));
+    if (this->HasEnergyWindow()) {
+      // bxdecay0 does not expose the Q-value, the upper bound cannot default to it
+      if (fEnergyWindowMax < 0) {
+        RMGLog::Out(RMGLog::fatal, "Energy window of the Decay0 generator has no upper bound, ",
+            "set it with EnergyWindowMax (the Q-value for a lower bound only)");
+      }
+      auto e_min = std::max<G4double>(0, fEnergyWindowMin);
+      if (fEnergyWindowMax <= e_min) {
+        RMGLog::Out(RMGLog::fatal, "Invalid energy window [", e_min/CLHEP::keV, ", ",
+            fEnergyWindowMax/CLHEP::keV, "] keV for the Decay0 generator");
+      }
+      generator->set_decay_dbd_esum_range(e_min/CLHEP::MeV, fEnergyWindowMax/CLHEP::MeV);
+    }
+  }
+
+  // the spectrum tables are computed here, once per configuration
+  try { generator->initialize(fRandom); }
+  catch (const std::exception& e) {
+    RMGLog::Out(RMGLog::fatal, "Could not initialize BxDecay0 for nuclide '", fNuclide, "': ", e.what());
+  }
+  fSharedGenerator->generator = std::move(generator);
+
+  RMGLog::Out(RMGLog::detail, "Decay0 generator initialized for nuclide ", fNuclide);
+}
+
+void RMGGeneratorDecay0::ShootDecay() {
+
+  if (!fSharedGenerator) this->Initialize();
+
+  fDecay.reset();
+  {
+    std::lock_guard<std::mutex> lock(fSharedGenerator->mutex);
+    fSharedGenerator->generator->shoot(fRandom, fDecay);
+  }
+
+  // bxdecay0 weights the events only if the summed energy is restricted
+  if (this->HasEnergyWindow()) {
+    fEventWeight = fDecay.get_generation_weight();
+    if (fRunNGenerated) {
+      *fRunNGenerated += 1;
+      *fRunSumOfWeights += fEventWeight;
+    }
+  }
 }
 
 void RMGGeneratorDecay0::GeneratePrimaryVertex(G4Event* event) {
-  fDecay0G4Generator->GeneratePrimaries(event);
+
+  this->ShootDecay();
+
+  // consecutive particles with the same time share a vertex
+  G4PrimaryVertex* vertex = nullptr;
+  for (const auto& p : fDecay.get_particles()) {
+    auto time = p.get_time() * CLHEP::second;
+    if (!vertex or time != vertex->GetT0()) {
+      vertex = new G4PrimaryVertex(fParticlePosition, time);
+      event->AddPrimaryVertex(vertex);
+    }
+    vertex->SetPrimary(new G4PrimaryParticle(GetParticleDefinition(p),
+          p.get_px()*CLHEP::MeV, p.get_py()*CLHEP::MeV, p.get_pz()*CLHEP::MeV));
+  }
+}
+
+void RMGGeneratorDecay0::GeneratePrimaryBatch(RMGPrimaryBatch& batch) {
+
+  for (size_t i = 0; i < batch.GetNumberOfEvents(); ++i) {
+    this->ShootDecay();
+    for (const auto& p : fDecay.get_particles()) {
+      auto particle = GetParticleDefinition(p);
+      batch.AddPrimary(particle, G4ThreeVector(p.get_px(), p.get_py(), p.get_pz())*CLHEP::MeV,
+          particle->GetPDGCharge(), G4ThreeVector(0, 0, 0), p.get_time()*CLHEP::second);
+    }
+    batch.weight[i] *= fEventWeight;
+    batch.CloseEvent();
+  }
+}
+
+void RMGGeneratorDecay0::BeginOfRunAction(const G4Run*) {
+
+  auto run = RMGRun::GetCurrent();
+  if (run and this->HasEnergyWindow()) {
+    // the worker runs are merged before their end of run action, count in
+    // the run directly
+    fRunNGenerated = &run->GetCounter("Decay0/" + fNuclide + "/n_generated");
+    fRunSumOfWeights = &run->GetCounter("Decay0/" + fNuclide + "/sum_of_weights");
+  }
+}
+
+void RMGGeneratorDecay0::EndOfRunAction(const G4Run*) {
+  fRunNGenerated = nullptr;
+  fRunSumOfWeights = nullptr;
+}
+
+void RMGGeneratorDecay0::PrintRunSummary(const RMGRun& run) {
+
+  // counters are named Decay0/<nuclide>/<quantity>
+  const G4String prefix = "Decay0/", suffix = "/n_generated";
+  for (const auto& c : run.GetCounters()) {
+    const auto& name = c.first;
+    if (name.compare(0, prefix.size(), prefix) != 0 or name.size() <= prefix.size() + suffix.size() or
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+    if (c.second <= 0) continue;
+
+    auto nuclide = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    RMGLog::Out(RMGLog::summary, "Decay0: ", c.second, " decays of ", nuclide,
+        " generated in the energy window, each representing a fraction ",
+        run.GetCounterValue(prefix + nuclide + "/sum_of_weights") / c.second, " of all decays");
+  }
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
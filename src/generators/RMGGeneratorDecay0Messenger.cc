@@ -0,0 +1,66 @@
+#include "RMGGeneratorDecay0Messenger.hh"
+
+#include "RMGGeneratorDecay0.hh"
+#include "RMGTools.hh"
+#include "RMGLog.hh"
+
+RMGGeneratorDecay0Messenger::RMGGeneratorDecay0Messenger(RMGGeneratorDecay0* generator) :
+  fGenerator(generator) {
+
+  G4String directory = "/RMG/Generators/Decay0";
+  fDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
+
+  std::vector<G4ApplicationState> states = {G4State_PreInit, G4State_Init, G4State_Idle};
+
+  fCategoryCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/Category", this,
+      "Background DoubleBeta", states);
+
+  // in the BxDecay0 notation, e.g. Co60, Ge76
+  fNuclideCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/Nuclide", this, "", states);
+
+  // the BxDecay0 double beta decay mode number, e.g. 4 for 2vbb
+  fDoubleBetaModeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/DoubleBeta/Mode", this, "M", "M > 0", states);
+
+  // level of the daughter nucleus, zero is the ground state
+  fDoubleBetaLevelCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/DoubleBeta/Level", this, "L", "L >= 0", states);
+
+  // window on the summed electron energy, only double beta decays in the
+  // window are generated and events are weighted accordingly
+  fEnergyWindowMinCmd = RMGTools::MakeG4UIcmdWithANumberAndUnit<G4UIcmdWithADoubleAndUnit>(
+      directory + "/DoubleBeta/EnergyWindowMin", this, "Energy", "keV", "E", "E >= 0", states);
+  fEnergyWindowMinCmd->SetGuidance("Lower bound of the summed electron energy window, zero if not set. "
+      "Needs EnergyWindowMax");
+
+  fEnergyWindowMaxCmd = RMGTools::MakeG4UIcmdWithANumberAndUnit<G4UIcmdWithADoubleAndUnit>(
+      directory + "/DoubleBeta/EnergyWindowMax", this, "Energy", "keV", "E", "E > 0", states);
+  fEnergyWindowMaxCmd->SetGuidance("Upper bound of the summed electron energy window, use the Q-value "
+      "for a lower bound only");
+}
+
+void RMGGeneratorDecay0Messenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
+
+  if (cmd == fCategoryCmd.get()) {
+    if (new_values == "Background") fGenerator->SetDecayCategory(RMGGeneratorDecay0::DecayCategory::kBackground);
+    else if (new_values == "DoubleBeta") fGenerator->SetDecayCategory(RMGGeneratorDecay0::DecayCategory::kDoubleBeta);
+  }
+  else if (cmd == fNuclideCmd.get()) {
+    fGenerator->SetNuclide(new_values);
+  }
+  else if (cmd == fDoubleBetaModeCmd.get()) {
+    fGenerator->SetDoubleBetaMode(fDoubleBetaModeCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fDoubleBetaLevelCmd.get()) {
+    fGenerator->SetDoubleBetaLevel(fDoubleBetaLevelCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fEnergyWindowMinCmd.get()) {
+    fGenerator->SetEnergyWindowMin(fEnergyWindowMinCmd->GetNewDoubleValue(new_values));
+  }
+  else if (cmd == fEnergyWindowMaxCmd.get()) {
+    fGenerator->SetEnergyWindowMax(fEnergyWindowMaxCmd->GetNewDoubleValue(new_values));
+  }
+  else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), " not known");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,157 @@
+#include "RMGGeneratorEventLibrary.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4ParticleTable.hh"
+#include "G4IonTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "RMGGeneratorEventLibraryMessenger.hh"
+#include "RMGPrimaryBatch.hh"
+#include "RMGLog.hh"
+
+constexpr const char* RMGGeneratorEventLibrary::kMagic;
+constexpr std::uint32_t RMGGeneratorEventLibrary::kVersion;
+
+RMGGeneratorEventLibrary::RMGGeneratorEventLibrary(G4bool with_messenger) :
+  RMGVGenerator("EventLibrary"),
+  fTracks(nullptr),
+  fOffsets(nullptr),
+  fWeights(nullptr),
+  fEventWeight(1),
+  fNEvents(0),
+  fCursor(0),
+  fIndependentEvents(false),
+  fRandomizeCursor(false) {
+
+  if (with_messenger) {
+    fG4Messenger = std::unique_ptr<RMGGeneratorEventLibraryMessenger>(new RMGGeneratorEventLibraryMessenger(this));
+  }
+}
+
+void RMGGeneratorEventLibrary::OpenFile() {
+
+  if (fFileName.empty()) RMGLog::Out(RMGLog::fatal, "No event library file name specified");
+  if (!fFile.Open(fFileName)) RMGLog::Out(RMGLog::fatal, "Could not open event library '", fFileName, "'");
+
+  EventLibraryHeader header;
+  if (fFile.GetSize() < sizeof(header)) {
+    RMGLog::Out(RMGLog::fatal, "Event library '", fFileName, "' is too short");
+  }
+  std::memcpy(&header, fFile.GetData(), sizeof(header));
+
+  if (std::strncmp(header.magic, kMagic, sizeof(header.magic)) != 0) {
+    RMGLog::Out(RMGLog::fatal, "'", fFileName, "' is not a remage event library");
+  }
+  // version 1 libraries have no weights
+  if (header.version < 1 or header.version > kVersion or header.record_size != sizeof(TrackRecord)) {
+    RMGLog::Out(RMGLog::fatal, "Event library '", fFileName, "' has unsupported format version ",
+        header.version, " (record size ", header.record_size, " bytes)");
+  }
+  auto expected_size = sizeof(header) + header.n_tracks * header.record_size
+    + (header.n_events + 1) * sizeof(std::uint64_t)
+    + (header.version >= 2 ? header.n_events * sizeof(G4double) : 0);
+  if (header.n_events == 0 or fFile.GetSize() < expected_size) {
+    RMGLog::Out(RMGLog::fatal, "Event library '", fFileName, "' is empty or truncated");
+  }
+
+  // header and records are multiples of 8 bytes, everything is properly aligned
+  fTracks = reinterpret_cast<const TrackRecord*>(fFile.GetData() + sizeof(header));
+  fOffsets = reinterpret_cast<const std::uint64_t*>(fTracks + header.n_tracks);
+  fWeights = header.version >= 2 ? reinterpret_cast<const G4double*>(fOffsets + header.n_events + 1) : nullptr;
+  fNEvents = header.n_events;
+
+  if (fOffsets[fNEvents] != header.n_tracks) {
+    RMGLog::Out(RMGLog::fatal, "Event library '", fFileName, "' has an inconsistent event index");
+  }
+
+  // threads replaying the same library share the sequence of events
+  fReplayCursor = RMGReplayCursor::Get(fFileName, fNEvents);
+
+  RMGLog::Out(RMGLog::detail, "Replaying ", fNEvents, " events (", header.n_tracks,
+      " tracks) from event library '", fFileName, "'");
+}
+
+std::uint64_t RMGGeneratorEventLibrary::NextEvent() {
+
+  if (!fFile.IsOpen()) this->OpenFile();
+
+  std::uint64_t i = 0;
+  G4bool first_repeat = false;
+  if (fIndependentEvents) {
+    if (fRandomizeCursor) {
+      fCursor = std::min<std::uint64_t>(G4UniformRand() * fNEvents, fNEvents - 1);
+      fRandomizeCursor = false;
+    }
+    i = fCursor;
+    if (++fCursor == fNEvents) fCursor = 0;
+    first_repeat = fReplayCursor->Count();
+  }
+  else i = fReplayCursor->Next(first_repeat);
+
+  if (first_repeat) {
+    RMGLog::Out(RMGLog::warning, "All the ", fNEvents, " events in '", fFileName,
+        "' have been used, events will be repeated from now on");
+  }
+
+  fEventWeight = fWeights ? fWeights[i] : 1;
+  return i;
+}
+
+const G4ParticleDefinition* RMGGeneratorEventLibrary::GetParticleDefinition(std::int32_t pdg_code) {
+
+  auto it = fParticleCache.find(pdg_code);
+  if (it != fParticleCache.end()) return it->second;
+
+  const G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(pdg_code);
+  // ions are created on demand
+  if (!particle and pdg_code > 1000000000) particle = G4IonTable::GetIonTable()->GetIon(pdg_code);
+  if (!particle) {
+    RMGLog::Out(RMGLog::fatal, "Unknown particle with PDG code ", pdg_code, " in event library '",
+        fFileName, "'");
+  }
+
+  fParticleCache.emplace(pdg_code, particle);
+  return particle;
+}
+
+void RMGGeneratorEventLibrary::GeneratePrimaryVertex(G4Event* event) {
+
+  auto i = this->NextEvent();
+
+  // consecutive tracks with the same time share a vertex
+  G4PrimaryVertex* vertex = nullptr;
+  for (auto t = fTracks + fOffsets[i]; t != fTracks + fOffsets[i+1]; ++t) {
+    if (!vertex or t->time*CLHEP::ns != vertex->GetT0()) {
+      vertex = new G4PrimaryVertex(fParticlePosition, t->time*CLHEP::ns);
+      event->AddPrimaryVertex(vertex);
+    }
+    vertex->SetPrimary(new G4PrimaryParticle(this->GetParticleDefinition(t->pdg_code),
+          t->px*CLHEP::MeV, t->py*CLHEP::MeV, t->pz*CLHEP::MeV));
+  }
+
+  // keep the event vertex even if there are no primaries
+  if (!vertex) event->AddPrimaryVertex(new G4PrimaryVertex(fParticlePosition, 0));
+}
+
+void RMGGeneratorEventLibrary::GeneratePrimaryBatch(RMGPrimaryBatch& batch) {
+
+  for (size_t k = 0; k < batch.GetNumberOfEvents(); ++k) {
+    auto i = this->NextEvent();
+    for (auto t = fTracks + fOffsets[i]; t != fTracks + fOffsets[i+1]; ++t) {
+      auto particle = this->GetParticleDefinition(t->pdg_code);
+      batch.AddPrimary(particle, G4ThreeVector(t->px, t->py, t->pz)*CLHEP::MeV,
+          particle->GetPDGCharge(), G4ThreeVector(0, 0, 0), t->time*CLHEP::ns);
+    }
+    batch.weight[k] *= fEventWeight;
+    batch.CloseEvent();
+  }
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
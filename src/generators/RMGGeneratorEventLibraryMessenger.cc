@@ -0,0 +1,23 @@
+#include "RMGGeneratorEventLibraryMessenger.hh"
+
+#include "RMGGeneratorEventLibrary.hh"
+#include "RMGTools.hh"
+#include "RMGLog.hh"
+
+RMGGeneratorEventLibraryMessenger::RMGGeneratorEventLibraryMessenger(RMGGeneratorEventLibrary* generator) :
+  fGenerator(generator) {
+
+  G4String directory = "/RMG/Generators/EventLibrary";
+  fDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
+
+  fFileNameCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/FileName", this, "",
+      {G4State_PreInit, G4State_Init, G4State_Idle});
+}
+
+void RMGGeneratorEventLibraryMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
+
+  if (cmd == fFileNameCmd.get()) fGenerator->SetFileName(new_values);
+  else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), " not known");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,131 @@
+#include "RMGGeneratorMultiSource.hh"
+
+#include "G4Event.hh"
+#include "G4Run.hh"
+
+#include "RMGGeneratorMultiSourceMessenger.hh"
+#include "RMGEventInformation.hh"
+#include "RMGRun.hh"
+#include "RMGLog.hh"
+
+namespace {
+  G4String GetSourceCounterName(size_t i) {
+    return "MultiSource/source_" + std::to_string(i) + "/n_events";
+  }
+}
+
+RMGGeneratorMultiSource::RMGGeneratorMultiSource() :
+  RMGVGenerator("MultiSource"),
+  fLastSource(-1) {
+
+  fG4Messenger = std::unique_ptr<RMGGeneratorMultiSourceMessenger>(new RMGGeneratorMultiSourceMessenger(this));
+}
+
+void RMGGeneratorMultiSource::AddSource(G4String volume_regex, G4String library, G4double activity) {
+
+  if (activity <= 0) {
+    RMGLog::Out(RMGLog::fatal, "Source in '", volume_regex, "' must have a positive activity");
+  }
+
+  Source s;
+  s.info = SourceInfo{volume_regex, library, activity};
+  s.confinement = std::unique_ptr<RMGGeneratorVolumeConfinement>(new RMGGeneratorVolumeConfinement(false));
+  s.confinement->AddPhysicalVolumeNameRegex(volume_regex);
+  s.generator = std::unique_ptr<RMGGeneratorEventLibrary>(new RMGGeneratorEventLibrary(false));
+  s.generator->SetFileName(library);
+  s.run_n_events = nullptr;
+  fSources.push_back(std::move(s));
+
+  // rebuilt at the first event
+  fSourceTable.clear();
+}
+
+RMGGeneratorVolumeConfinement* RMGGeneratorMultiSource::GetLastSourceConfinement() {
+  if (fSources.empty()) {
+    RMGLog::Out(RMGLog::fatal, "No source defined yet for the MultiSource generator, add one first");
+  }
+  return fSources.back().confinement.get();
+}
+
+void RMGGeneratorMultiSource::BeginOfRunAction(const G4Run* run) {
+
+  // the worker runs are merged before their end of run action, count in the
+  // run directly
+  auto rmg_run = RMGRun::GetCurrent();
+  std::vector<SourceInfo> infos;
+  for (size_t i = 0; i < fSources.size(); ++i) {
+    auto& s = fSources[i];
+    s.confinement->BeginOfRunAction(run);
+    s.generator->BeginOfRunAction(run);
+    s.run_n_events = rmg_run ? &rmg_run->GetCounter(GetSourceCounterName(i)) : nullptr;
+    infos.push_back(s.info);
+  }
+
+  // all threads have the same sources, the master reports them
+  if (!infos.empty()) {
+    RMGRun::RegisterSummary("MultiSource", [infos](const RMGRun& r) { PrintRunSummary(infos, r); });
+  }
+}
+
+void RMGGeneratorMultiSource::PrepareIndependentEvent() {
+  for (auto& s : fSources) {
+    s.confinement->PrepareIndependentEvent();
+    s.generator->PrepareIndependentEvent();
+  }
+}
+
+void RMGGeneratorMultiSource::GeneratePrimaryVertex(G4Event* event) {
+
+  if (fSourceTable.empty()) {
+    if (fSources.empty()) RMGLog::Out(RMGLog::fatal, "No sources defined for the MultiSource generator");
+    std::vector<G4double> activities;
+    for (const auto& s : fSources) activities.push_back(s.info.activity);
+    fSourceTable.Build(activities);
+  }
+
+  fLastSource = fSourceTable.Sample();
+  auto& s = fSources[fLastSource];
+
+  s.generator->SetParticlePosition(s.confinement->NextPrimaryPosition());
+  s.generator->GeneratePrimaryVertex(event);
+  if (s.run_n_events) *s.run_n_events += 1;
+
+  RMGEventInformation::GetOrCreate(event)->SetSourceID(fLastSource);
+}
+
+G4double RMGGeneratorMultiSource::GetEventWeight() const {
+  if (fLastSource < 0) return 1;
+  const auto& s = fSources[fLastSource];
+  return s.generator->GetEventWeight() * s.confinement->GetVertexWeight();
+}
+
+void RMGGeneratorMultiSource::EndOfRunAction(const G4Run* run) {
+
+  for (auto& s : fSources) {
+    s.confinement->EndOfRunAction(run);
+    s.generator->EndOfRunAction(run);
+    s.run_n_events = nullptr;
+  }
+}
+
+void RMGGeneratorMultiSource::PrintRunSummary(const std::vector<SourceInfo>& sources, const RMGRun& run) {
+
+  G4double n_events = 0, total_activity = 0;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    n_events += run.GetCounterValue(GetSourceCounterName(i));
+    total_activity += sources[i].activity;
+  }
+  if (n_events == 0) return;
+
+  // events are drawn proportionally to the activities, the number of events
+  // corresponds to a live time of N / total activity
+  RMGLog::Out(RMGLog::summary, "MultiSource: ", n_events, " events generated, corresponding to a live time of ",
+      n_events / total_activity, " s. Events per source:");
+  for (size_t i = 0; i < sources.size(); ++i) {
+    RMGLog::OutFormat(RMGLog::summary, " - [%zu] %-30s %-30s %10g Bq %.0f", i,
+        sources[i].volume_regex.c_str(), sources[i].library.c_str(), sources[i].activity,
+        run.GetCounterValue(GetSourceCounterName(i)));
+  }
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
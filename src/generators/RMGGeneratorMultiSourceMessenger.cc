@@ -0,0 +1,63 @@
+#include "RMGGeneratorMultiSourceMessenger.hh"
+
+#include <sstream>
+
+#include "RMGGeneratorMultiSource.hh"
+#include "RMGGeneratorVolumeConfinement.hh"
+#include "RMGTools.hh"
+#include "RMGLog.hh"
+
+RMGGeneratorMultiSourceMessenger::RMGGeneratorMultiSourceMessenger(RMGGeneratorMultiSource* generator) :
+  fGenerator(generator) {
+
+  G4String directory = "/RMG/Generators/MultiSource";
+  fDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
+
+  // <physical volume name regex> <event library> <activity in Bq>
+  fAddSourceCmd = std::unique_ptr<G4UIcommand>(new G4UIcommand((directory + "/AddSource").c_str(), this));
+  fAddSourceCmd->SetParameter(new G4UIparameter("VolumeRegex", 's', false));
+  fAddSourceCmd->SetParameter(new G4UIparameter("EventLibrary", 's', false));
+  auto a_par = new G4UIparameter("A", 'd', false);
+  a_par->SetParameterRange("A > 0");
+  fAddSourceCmd->SetParameter(a_par);
+  fAddSourceCmd->AvailableForStates(G4State_PreInit, G4State_Init, G4State_Idle);
+
+  fSamplingModeCmd = RMGTools::MakeG4UIcmdWithAString(
+      directory + "/SetSamplingMode", this, "UnionAll IntersectPhysicalWithGeometrical",
+      {G4State_PreInit, G4State_Init, G4State_Idle});
+  fSamplingModeCmd->SetGuidance("Sampling mode of the last added source");
+
+  fBoundingSolidTypeCmd = RMGTools::MakeG4UIcmdWithAString(
+      directory + "/SetFallbackBoundingVolumeType", this, "Auto Box Sphere Tube",
+      {G4State_PreInit, G4State_Init, G4State_Idle});
+  fBoundingSolidTypeCmd->SetGuidance("Fallback bounding volume type of the last added source");
+
+  fSampleOnSurfaceCmd = RMGTools::MakeG4UIcmdWithABool(directory + "/SampleOnSurface", this,
+      false, {G4State_PreInit, G4State_Init, G4State_Idle});
+  fSampleOnSurfaceCmd->SetGuidance("Sample the last added source on the surface of its volumes "
+      "instead of in their bulk");
+}
+
+void RMGGeneratorMultiSourceMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
+
+  if (cmd == fAddSourceCmd.get()) {
+    std::istringstream iss(new_values);
+    G4String regex, library; G4double activity = 0;
+    iss >> regex >> library >> activity;
+    fGenerator->AddSource(regex, library, activity);
+  }
+  else if (cmd == fSamplingModeCmd.get()) {
+    auto confinement = fGenerator->GetLastSourceConfinement();
+    if (new_values == "UnionAll") confinement->SetSamplingMode(RMGGeneratorVolumeConfinement::SamplingMode::kUnionAll);
+    else if (new_values == "IntersectPhysicalWithGeometrical") confinement->SetSamplingMode(RMGGeneratorVolumeConfinement::SamplingMode::kIntersectPhysicalWithGeometrical);
+  }
+  else if (cmd == fBoundingSolidTypeCmd.get()) {
+    fGenerator->GetLastSourceConfinement()->SetBoundingSolidType(new_values);
+  }
+  else if (cmd == fSampleOnSurfaceCmd.get()) {
+    fGenerator->GetLastSourceConfinement()->SetOnSurface(fSampleOnSurfaceCmd->GetNewBoolValue(new_values));
+  }
+  else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), " not known");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,29 +1,95 @@
 #include "RMGGeneratorPrimary.hh"
 
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+
 #include "RMGGeneratorPrimaryMessenger.hh"
 #include "RMGVGeneratorPrimaryPosition.hh"
 #include "RMGGeneratorVolumeConfinement.hh"
+#include "RMGGeneratorVertexFile.hh"
+#include "RMGGeneratorEventLibrary.hh"
 #include "RMGVGenerator.hh"
+#include "RMGEventInformation.hh"
+#include "RMGManager.hh"
 #include "RMGLog.hh"
 
 RMGGeneratorPrimary::RMGGeneratorPrimary():
-  fConfinementCode(ConfinementCode::kUnConfined) {
+  fConfinementCode(ConfinementCode::kUnConfined),
+  fBatchSize(0),
+  fPrimaryBatchCursor(0) {
 
   fG4Messenger = std::unique_ptr<RMGGeneratorPrimaryMessenger>(new RMGGeneratorPrimaryMessenger(this));
 }
 
 void RMGGeneratorPrimary::GeneratePrimaries(G4Event* event) {
 
-  if (!fPrimaryPositionGenerator) RMGLog::Out(RMGLog::fatal, "No primary position generator specified!");
   if (!fRMGGenerator) RMGLog::Out(RMGLog::fatal, "No generator specified!");
+  auto own_vertices = fRMGGenerator->PlacesOwnVertices();
+  if (!own_vertices and !fPrimaryPositionGenerator) {
+    RMGLog::Out(RMGLog::fatal, "No primary position generator specified!");
+  }
 
-  fRMGGenerator->SetParticlePosition(fPrimaryPositionGenerator->ShootPrimaryPosition());
+  // the Geant4 worker seeding is overridden here, before anything is drawn.
+  // Batches mix the random streams of several events, they are not used.
+  // Generators placing their own vertices are not batched either
+  auto manager = RMGManager::GetRMGManager();
+  if (manager and manager->GetPerEventSeeding()) {
+    fRMGGenerator->PrepareIndependentEvent();
+    if (!own_vertices) fPrimaryPositionGenerator->PrepareIndependentEvent();
+    auto run = G4RunManager::GetRunManager()->GetCurrentRun();
+    manager->SeedEvent(run ? run->GetRunID() : 0, event->GetEventID());
+  }
+  else if (fBatchSize > 1 and fRMGGenerator->IsBatchCapable() and !own_vertices) {
+    if (fPrimaryBatchCursor >= fPrimaryBatch.GetNumberOfClosedEvents()) this->FillPrimaryBatch();
+    fPrimaryBatch.FillEvent(fPrimaryBatchCursor++, event);
+    return;
+  }
+
+  if (own_vertices) {
+    fRMGGenerator->GeneratePrimaryVertex(event);
+    RMGEventInformation::GetOrCreate(event)->SetWeight(fRMGGenerator->GetEventWeight());
+    return;
+  }
+
+  fRMGGenerator->SetParticlePosition(fPrimaryPositionGenerator->NextPrimaryPosition());
   fRMGGenerator->GeneratePrimaryVertex(event);
+
+  RMGEventInformation::GetOrCreate(event)->SetWeight(
+      fRMGGenerator->GetEventWeight() * fPrimaryPositionGenerator->GetVertexWeight());
+}
+
+void RMGGeneratorPrimary::FillPrimaryBatch() {
+
+  fPrimaryBatch.Clear();
+  fPrimaryBatch.Reserve(fBatchSize);
+  for (size_t i = 0; i < fBatchSize; ++i) {
+    // the weight belongs to the vertex just drawn
+    auto vertex = fPrimaryPositionGenerator->NextPrimaryPosition();
+    fPrimaryBatch.AddVertex(vertex, 0, fPrimaryPositionGenerator->GetVertexWeight());
+  }
+
+  fRMGGenerator->GeneratePrimaryBatch(fPrimaryBatch);
+
+  if (fPrimaryBatch.GetNumberOfClosedEvents() != fBatchSize) {
+    RMGLog::Out(RMGLog::fatal, "Generator '", fRMGGenerator->GetGeneratorName(), "' filled ",
+        fPrimaryBatch.GetNumberOfClosedEvents(), " events out of a batch of ", fBatchSize);
+  }
+  fPrimaryBatchCursor = 0;
 }
 
 void RMGGeneratorPrimary::SetConfinementCode(RMGGeneratorPrimary::ConfinementCode code) {
 
   fConfinementCode = code;
+  this->ClearPrimaryBatch();
 
   switch (fConfinementCode) {
     case ConfinementCode::kUnConfined :
@@ -32,9 +98,91 @@ void RMGGeneratorPrimary::SetConfinementCode(RMGGeneratorPrimary::ConfinementCod
     case ConfinementCode::kVolume :
       fPrimaryPositionGenerator = std::unique_ptr<RMGGeneratorVolumeConfinement>(new RMGGeneratorVolumeConfinement());
       break;
+    case ConfinementCode::kFromFile :
+      fPrimaryPositionGenerator = std::unique_ptr<RMGGeneratorVertexFile>(new RMGGeneratorVertexFile());
+      break;
     default : RMGLog::Out(RMGLog::fatal, "No sampling strategy for confinement '",
                                          fConfinementCode, "' specified (implement me)");
   }
 }
 
+void RMGGeneratorPrimary::WriteEventLibrary(G4String file_name, size_t n) {
+
+  if (!fRMGGenerator) RMGLog::Out(RMGLog::fatal, "No generator specified!");
+  if (n == 0) RMGLog::Out(RMGLog::fatal, "Refusing to write an empty event library");
+
+  using TrackRecord = RMGGeneratorEventLibrary::TrackRecord;
+
+  RMGGeneratorEventLibrary::EventLibraryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::strncpy(header.magic, RMGGeneratorEventLibrary::kMagic, sizeof(header.magic));
+  header.version = RMGGeneratorEventLibrary::kVersion;
+  header.record_size = sizeof(TrackRecord);
+  header.n_events = n;
+
+  // write to a temporary file first, such that an aborted job does not leave a
+  // truncated file behind that would be picked up by later runs
+  auto tmp_name = file_name + ".tmp";
+  std::ofstream file(tmp_name, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) RMGLog::Out(RMGLog::fatal, "Could not open '", tmp_name, "' for writing");
+
+  // the number of tracks is known only at the end, the header is rewritten then
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  RMGLog::Out(RMGLog::summary, "Writing ", n, " events generated by '",
+      fRMGGenerator->GetGeneratorName(), "' to event library '", file_name, "'");
+
+  // the position is not stored, vertices are placed at replay time
+  fRMGGenerator->SetParticlePosition(G4ThreeVector(0, 0, 0));
+
+  std::vector<std::uint64_t> offsets;
+  offsets.reserve(n + 1);
+  offsets.push_back(0);
+  std::vector<G4double> weights;
+  weights.reserve(n);
+
+  const size_t block_size = 4096;
+  std::vector<TrackRecord> block;
+  block.reserve(block_size);
+  for (size_t i = 0; i < n; ++i) {
+    G4Event event(i);
+    fRMGGenerator->GeneratePrimaryVertex(&event);
+
+    for (G4int j = 0; j < event.GetNumberOfPrimaryVertex(); ++j) {
+      auto vertex = event.GetPrimaryVertex(j);
+      for (auto p = vertex->GetPrimary(); p; p = p->GetNext()) {
+        TrackRecord r;
+        r.pdg_code = p->GetPDGcode();
+        r.px = p->GetPx() / CLHEP::MeV;
+        r.py = p->GetPy() / CLHEP::MeV;
+        r.pz = p->GetPz() / CLHEP::MeV;
+        r.time = vertex->GetT0() / CLHEP::ns;
+        block.push_back(r);
+        header.n_tracks++;
+      }
+    }
+    offsets.push_back(header.n_tracks);
+    weights.push_back(fRMGGenerator->GetEventWeight());
+
+    if (block.size() >= block_size) {
+      file.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(TrackRecord));
+      block.clear();
+    }
+  }
+  file.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(TrackRecord));
+  file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size()*sizeof(std::uint64_t));
+  file.write(reinterpret_cast<const char*>(weights.data()), weights.size()*sizeof(G4double));
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  file.close();
+  if (!file or std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+    std::remove(tmp_name.c_str());
+    RMGLog::Out(RMGLog::fatal, "Could not write event library '", file_name, "'");
+  }
+
+  RMGLog::Out(RMGLog::detail, "Event library '", file_name, "' contains ", header.n_tracks, " tracks");
+}
+
 // vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,12 +1,17 @@
 #include "RMGGeneratorPrimaryMessenger.hh"
 
+#include <sstream>
+
 #include "globals.hh"
+#include "G4Threading.hh"
 #include "G4PhysicalVolumeStore.hh"
 
 #include "RMGVGenerator.hh"
 #include "RMGGeneratorPrimary.hh"
 #include "RMGGeneratorG4Gun.hh"
 #include "RMGGeneratorSPS.hh"
+#include "RMGGeneratorEventLibrary.hh"
+#include "RMGGeneratorMultiSource.hh"
 #include "RMGTools.hh"
 #include "RMGLog.hh"
 #include "ProjectInfo.hh"
@@ -20,7 +25,7 @@ RMGGeneratorPrimaryMessenger::RMGGeneratorPrimaryMessenger(RMGGeneratorPrimary*
   G4String directory = "/RMG/Generator";
   fGeneratorDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
 
-  G4String generators = "SPS G4Gun";
+  G4String generators = "SPS G4Gun EventLibrary MultiSource";
 #if RMG_HAS_BXDECAY0
   generators += " Decay0";
 #endif
@@ -29,18 +34,40 @@ RMGGeneratorPrimaryMessenger::RMGGeneratorPrimaryMessenger(RMGGeneratorPrimary*
       directory + "/Select", this, generators, {G4State_Init, G4State_PreInit});
 
   fConfineCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/Confine", this,
-    "UnConfined Volume");
+    "UnConfined Volume FromFile");
+
+  // number of events generated at once by batch capable generators
+  fBatchSizeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/BatchSize", this, "N", "N >= 0");
+
+  // <file name> <number of events>
+  fWriteEventLibraryCmd = std::unique_ptr<G4UIcommand>(new G4UIcommand((directory + "/WriteEventLibrary").c_str(), this));
+  fWriteEventLibraryCmd->SetParameter(new G4UIparameter("FileName", 's', false));
+  auto n_par = new G4UIparameter("N", 'l', false);
+  n_par->SetParameterRange("N > 0");
+  fWriteEventLibraryCmd->SetParameter(n_par);
+  fWriteEventLibraryCmd->SetGuidance("Generate N events with the current generator and write them to an event library");
+  fWriteEventLibraryCmd->SetGuidance("In multi-threaded mode the file is written by the first worker thread, "
+      "when the commands are passed on to the workers at the beginning of the next run (/run/beamOn with "
+      "at least one event); it is not there before. In sequential mode it is written right away");
+  fWriteEventLibraryCmd->AvailableForStates(G4State_Idle);
 }
 
 void RMGGeneratorPrimaryMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
 
   if (cmd == fSelectCmd.get()) {
-    if (new_values == "G4gun") {
+    if (new_values == "G4Gun") {
       fGeneratorPrimary->SetGenerator(new RMGGeneratorG4Gun);
     }
     else if (new_values == "SPS") {
       fGeneratorPrimary->SetGenerator(new RMGGeneratorSPS);
     }
+    else if (new_values == "EventLibrary") {
+      fGeneratorPrimary->SetGenerator(new RMGGeneratorEventLibrary);
+    }
+    else if (new_values == "MultiSource") {
+      fGeneratorPrimary->SetGenerator(new RMGGeneratorMultiSource);
+    }
 #if RMG_HAS_BXDECAY0
     else if (new_values == "Decay0") {
       fGeneratorPrimary->SetGenerator(new RMGGeneratorDecay0);
@@ -50,9 +77,21 @@ void RMGGeneratorPrimaryMessenger::SetNewValue(G4UIcommand* cmd, G4String new_va
   }
   else if (cmd == fConfineCmd.get()) {
     if (new_values == "Volume") fGeneratorPrimary->SetConfinementCode(RMGGeneratorPrimary::ConfinementCode::kVolume);
+    if (new_values == "FromFile") fGeneratorPrimary->SetConfinementCode(RMGGeneratorPrimary::ConfinementCode::kFromFile);
     if (new_values == "UnConfined") fGeneratorPrimary->SetConfinementCode(RMGGeneratorPrimary::ConfinementCode::kUnConfined);
   }
-  // else if
+  else if (cmd == fBatchSizeCmd.get()) {
+    fGeneratorPrimary->SetBatchSize(fBatchSizeCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fWriteEventLibraryCmd.get()) {
+    std::istringstream iss(new_values);
+    G4String file_name; size_t n = 0;
+    iss >> file_name >> n;
+    // all threads share the same messenger commands, let only one of them
+    // write. The master has no generator, in multi-threaded mode worker 0
+    // writes at the beginning of the next run (see the guidance)
+    if (G4Threading::G4GetThreadId() <= 0) fGeneratorPrimary->WriteEventLibrary(file_name, n);
+  }
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
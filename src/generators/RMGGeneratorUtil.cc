@@ -1,122 +1,556 @@
 #include "RMGGeneratorUtil.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
 #include "Randomize.hh"
+#include "G4CutTubs.hh"
+#include "G4Torus.hh"
 
 #include "RMGLog.hh"
 
+namespace {
+
+  // installed by RMGGeneratorUtil::UniformBatch, empty otherwise
+  G4ThreadLocal const G4double* tUniformsNext = nullptr;
+  G4ThreadLocal const G4double* tUniformsEnd = nullptr;
+
+  inline G4double NextUniform() {
+    return tUniformsNext != tUniformsEnd ? *tUniformsNext++ : ::G4UniformRand();
+  }
+}
+
 #ifndef _g4rand
-#define _g4rand() ::G4UniformRand()
+#define _g4rand() NextUniform()
 #endif
 
+namespace {
+
+  // ear clipping triangulation of a simple polygon, collinear and repeated
+  // points are allowed (they produce null-area triangles)
+  std::vector<std::array<G4TwoVector, 3>> Triangulate(std::vector<G4TwoVector> poly) {
+
+    std::vector<std::array<G4TwoVector, 3>> triangles;
+
+    auto cross = [](const G4TwoVector& o, const G4TwoVector& a, const G4TwoVector& b) {
+      return (a.x() - o.x())*(b.y() - o.y()) - (a.y() - o.y())*(b.x() - o.x());
+    };
+
+    // make it counter-clockwise
+    G4double signed_area = 0;
+    for (size_t i = 0; i < poly.size(); ++i) {
+      const auto& a = poly[i];
+      const auto& b = poly[(i+1) % poly.size()];
+      signed_area += a.x()*b.y() - b.x()*a.y();
+    }
+    if (signed_area < 0) std::reverse(poly.begin(), poly.end());
+
+    while (poly.size() > 3) {
+      auto n = poly.size();
+      size_t ear = n;
+      G4double best_cross = -std::numeric_limits<G4double>::max();
+      size_t best = 0;
+      for (size_t i = 0; i < n and ear == n; ++i) {
+        const auto& a = poly[(i+n-1) % n];
+        const auto& b = poly[i];
+        const auto& c = poly[(i+1) % n];
+        auto cr = cross(a, b, c);
+        if (cr > best_cross) { best_cross = cr; best = i; }
+        if (cr < 0) continue; // reflex vertex
+
+        G4bool empty = true;
+        for (size_t j = 0; j < n and empty; ++j) {
+          if (j == i or j == (i+n-1) % n or j == (i+1) % n) continue;
+          const auto& p = poly[j];
+          if (cross(a, b, p) > 0 and cross(b, c, p) > 0 and cross(c, a, p) > 0) empty = false;
+        }
+        if (empty) ear = i;
+      }
+      // only reachable because of rounding errors, cut the most convex vertex
+      if (ear == n) ear = best;
+
+      triangles.push_back({poly[(ear+n-1) % n], poly[ear], poly[(ear+1) % n]});
+      poly.erase(poly.begin() + ear);
+    }
+    if (poly.size() == 3) triangles.push_back({poly[0], poly[1], poly[2]});
+
+    return triangles;
+  }
+
+  // contour of a polycone-like solid, from its corners
+  template <class T> std::vector<G4TwoVector> GetRZContour(const T* solid) {
+    std::vector<G4TwoVector> contour;
+    for (G4int i = 0; i < solid->GetNumRZCorner(); ++i) {
+      contour.emplace_back(solid->GetCorner(i).r, solid->GetCorner(i).z);
+    }
+    return contour;
+  }
+
+  // contour samplers are immutable: threads sampling the same solid, or
+  // solids of the same shape, share one built once per process. Keyed by the
+  // dimensions, such that parameterised solids changing shape are safe
+  std::shared_ptr<const RMGGeneratorUtil::RZContourSampler> GetContourSampler(
+      const std::vector<G4TwoVector>& contour, G4double start_phi, G4double delta_phi, G4int n_sides = 0) {
+
+    std::ostringstream ss;
+    ss.precision(17);
+    for (const auto& p : contour) ss << p.x() << " " << p.y() << " ";
+    ss << start_phi << " " << delta_phi << " " << n_sides;
+
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const RMGGeneratorUtil::RZContourSampler>> samplers;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& sampler = samplers[ss.str()];
+    if (!sampler) {
+      sampler = std::make_shared<const RMGGeneratorUtil::RZContourSampler>(contour, start_phi,
+          delta_phi, n_sides);
+    }
+    return sampler;
+  }
+
+  // contour of a G4Cons, its inner and outer radii at both ends
+  std::vector<G4TwoVector> GetRZContour(const G4Cons* cons) {
+    auto dz = cons->GetZHalfLength();
+    return {
+      {cons->GetInnerRadiusMinusZ(), -dz}, {cons->GetOuterRadiusMinusZ(), -dz},
+      {cons->GetOuterRadiusPlusZ(),   dz}, {cons->GetInnerRadiusPlusZ(),   dz}
+    };
+  }
+
+  G4ThreeVector SampleBox(G4double dx, G4double dy, G4double dz, G4bool on_surface) {
+
+    if (on_surface) {
+      auto A1 = 4*dx*dy, A2 = 4*dx*dz, A3 = 4*dy*dz;
+      auto face = _g4rand()*(A1 + A2 + A3);
+      auto face_sign = _g4rand() <= 0.5 ? -1 : 1;
+
+      if (face <= A1) return G4ThreeVector(dx*(2*_g4rand()-1), dy*(2*_g4rand()-1), dz*face_sign);
+      else if (face <= A1 + A2) return G4ThreeVector(dx*(2*_g4rand()-1), dy*face_sign, dz*(2*_g4rand()-1));
+      else return G4ThreeVector(dx*face_sign, dy*(2*_g4rand()-1), dz*(2*_g4rand()-1));
+    }
+    else {
+      return G4ThreeVector(dx * (2*_g4rand() - 1),
+                           dy * (2*_g4rand() - 1),
+                           dz * (2*_g4rand() - 1));
+    }
+  }
+
+  G4ThreeVector SampleSphere(G4double r1, G4double r2, G4double phi1, G4double delta_phi,
+      G4double cos_theta1, G4double cos_theta2, G4bool on_surface) {
+
+    auto phi = phi1 + delta_phi * _g4rand();
+    auto cos_theta = cos_theta1 + (cos_theta2 - cos_theta1) * _g4rand();
+    auto sin_theta = std::sqrt(1 - cos_theta*cos_theta);
+    auto s2_point = G4ThreeVector(sin_theta*std::cos(phi), sin_theta*std::sin(phi), cos_theta);
+
+    if (on_surface) {
+      // the solid angle is the same for both spherical surfaces
+      if (_g4rand()*(r1*r1 + r2*r2) <= r1*r1) return s2_point * r1;
+      else return s2_point * r2;
+    }
+    else {
+      // uniform in r^3
+      auto r1_3 = r1*r1*r1;
+      return s2_point * std::cbrt(r1_3 + _g4rand()*(r2*r2*r2 - r1_3));
+    }
+  }
+
+  G4ThreeVector SampleTubs(G4double r1, G4double r2, G4double dz, G4double phi1,
+      G4double delta_phi, G4bool on_surface) {
+
+    auto phi = phi1 + delta_phi * _g4rand();
+    auto z = dz * (2*_g4rand() - 1);
+    auto s1_point = G4ThreeVector(std::cos(phi), std::sin(phi), 0);
+
+    // uniform in r^2
+    auto rand_r = [r1, r2]() { return std::sqrt(r1*r1 + _g4rand()*(r2*r2 - r1*r1)); };
+
+    if (on_surface) {
+      auto A1 = r1*2*dz;
+      auto A2 = r2*2*dz;
+      auto A3 = (r2*r2 - r1*r1)/2;
+      auto face = _g4rand()*(A1 + A2 + A3*2);
+      if (face <= A1) return s1_point*r1 + G4ThreeVector(0, 0, z);
+      else if (face <= A1 + A2) return s1_point*r2 + G4ThreeVector(0, 0, z);
+      else {
+        auto face_sign = _g4rand() <= 0.5 ? 1 : -1;
+        return s1_point*rand_r() + G4ThreeVector(0, 0, face_sign * dz);
+      }
+    }
+    else return s1_point*rand_r() + G4ThreeVector(0, 0, z);
+  }
+
+  G4ThreeVector SampleTrd(G4double x1, G4double x2, G4double y1, G4double y2, G4double dz,
+      G4bool on_surface) {
+
+    // t in [0, 1] from the linear density a*(1-t) + b*t
+    auto linear_rand = [](G4double a, G4double b) {
+      if (_g4rand()*(a + b) < a) return 1 - std::sqrt(_g4rand());
+      else return std::sqrt(_g4rand());
+    };
+
+    if (on_surface) {
+      auto A_bottom = 4*x1*y1;
+      auto A_top = 4*x2*y2;
+      // the x faces have width 2y(t) and slant height sqrt((x2-x1)^2 + (2dz)^2)
+      auto A_x = (y1 + y2) * std::sqrt((x2-x1)*(x2-x1) + 4*dz*dz);
+      auto A_y = (x1 + x2) * std::sqrt((y2-y1)*(y2-y1) + 4*dz*dz);
+      auto face = _g4rand()*(A_bottom + A_top + 2*A_x + 2*A_y);
+      auto sign = _g4rand() <= 0.5 ? -1 : 1;
+
+      if (face <= A_bottom) return G4ThreeVector(x1*(2*_g4rand()-1), y1*(2*_g4rand()-1), -dz);
+      face -= A_bottom;
+      if (face <= A_top) return G4ThreeVector(x2*(2*_g4rand()-1), y2*(2*_g4rand()-1), dz);
+      face -= A_top;
+      if (face <= 2*A_x) {
+        auto t = linear_rand(y1, y2);
+        auto y = y1 + t*(y2-y1);
+        return G4ThreeVector(sign*(x1 + t*(x2-x1)), y*(2*_g4rand()-1), dz*(2*t-1));
+      }
+      auto t = linear_rand(x1, x2);
+      auto x = x1 + t*(x2-x1);
+      return G4ThreeVector(x*(2*_g4rand()-1), sign*(y1 + t*(y2-y1)), dz*(2*t-1));
+    }
+    else {
+      // the section area x(t)*y(t) is a quadratic polynomial with non-negative
+      // Bernstein coefficients, each Bernstein basis polynomial is the density
+      // of an order statistic of three uniform numbers
+      std::array<G4double, 3> c = {x1*y1, (x1*y2 + x2*y1)/2, x2*y2};
+      auto k = _g4rand()*(c[0] + c[1] + c[2]) < c[0] ? 0 : (_g4rand()*(c[1] + c[2]) < c[1] ? 1 : 2);
+      std::array<G4double, 3> u = {_g4rand(), _g4rand(), _g4rand()};
+      std::sort(u.begin(), u.end());
+      auto t = u[k];
+
+      return G4ThreeVector((x1 + t*(x2-x1)) * (2*_g4rand()-1),
+                           (y1 + t*(y2-y1)) * (2*_g4rand()-1),
+                           dz * (2*t-1));
+    }
+  }
+}
+
 G4bool RMGGeneratorUtil::IsSampleable(G4String g4_solid_type) {
   if (g4_solid_type == "G4Box" or
       g4_solid_type == "G4Orb" or
       g4_solid_type == "G4Sphere" or
-      g4_solid_type == "G4Tubs") return true;
+      g4_solid_type == "G4Tubs" or
+      g4_solid_type == "G4Cons" or
+      g4_solid_type == "G4Trd" or
+      g4_solid_type == "G4Polycone" or
+      g4_solid_type == "G4GenericPolycone" or
+      g4_solid_type == "G4Polyhedra") return true;
   else return false;
 }
 
+RMGGeneratorUtil::BoundingSolid RMGGeneratorUtil::MakeBoundingSolid(const G4VSolid* solid, G4String type) {
+
+  if (type != "Auto" and type != "Box" and type != "Sphere" and type != "Tube") {
+    RMGLog::Out(RMGLog::fatal, "Bounding solid type '", type, "' not supported (implement me)");
+  }
+
+  G4ThreeVector pmin, pmax;
+  solid->BoundingLimits(pmin, pmax);
+  auto center = 0.5*(pmax + pmin);
+  auto half = 0.5*(pmax - pmin);
+
+  // solids symmetric around the z-axis are better enclosed by a tube centred
+  // on the axis than by one centred on the bounding box, which would
+  // circumscribe the box corners. The natively sampleable ones never get here
+  auto entity = solid->GetEntityType();
+
+  auto box_volume = 8*half.x()*half.y()*half.z();
+
+  G4ThreeVector orb_center = center;
+  auto orb_radius = half.mag();
+  auto orb_volume = 4./3*CLHEP::pi*std::pow(orb_radius, 3);
+
+  // the bounding box of a phi segment can be well within the outer radius,
+  // which is used instead
+  G4ThreeVector tube_center = center;
+  auto tube_radius = half.perp();
+  if (entity == "G4CutTubs") {
+    tube_center = G4ThreeVector(0, 0, center.z());
+    tube_radius = dynamic_cast<const G4CutTubs*>(solid)->GetOuterRadius();
+  }
+  else if (entity == "G4Torus") {
+    auto torus = dynamic_cast<const G4Torus*>(solid);
+    tube_center = G4ThreeVector(0, 0, center.z());
+    tube_radius = torus->GetRtor() + torus->GetRmax();
+  }
+  auto tube_volume = CLHEP::pi*tube_radius*tube_radius*2*half.z();
+
+  if (type == "Auto") {
+    if (box_volume <= orb_volume and box_volume <= tube_volume) type = "Box";
+    else if (tube_volume <= orb_volume) type = "Tube";
+    else type = "Sphere";
+  }
+
+  BoundingSolid bounding;
+  bounding.type = type;
+  bounding.half = half;
+  if (type == "Box") {
+    bounding.offset = center;
+    bounding.radius = 0;
+    bounding.volume = box_volume;
+  }
+  else if (type == "Tube") {
+    bounding.offset = tube_center;
+    bounding.radius = tube_radius;
+    bounding.volume = tube_volume;
+  }
+  else {
+    bounding.offset = orb_center;
+    bounding.radius = orb_radius;
+    bounding.volume = orb_volume;
+  }
+  return bounding;
+}
+
 G4ThreeVector RMGGeneratorUtil::rand(const G4VSolid* vol, G4bool on_surface) {
   auto entity = vol->GetEntityType();
   if (entity == "G4Sphere") return RMGGeneratorUtil::rand(dynamic_cast<const G4Sphere*>(vol), on_surface);
   if (entity == "G4Orb")    return RMGGeneratorUtil::rand(dynamic_cast<const G4Orb*>(vol), on_surface);
   if (entity == "G4Box")    return RMGGeneratorUtil::rand(dynamic_cast<const G4Box*>(vol), on_surface);
   if (entity == "G4Tubs")   return RMGGeneratorUtil::rand(dynamic_cast<const G4Tubs*>(vol), on_surface);
-  else {
-    RMGLog::Out(RMGLog::fatal, "'", entity, "' is not supported (implement me)");
-    return G4ThreeVector();
+  if (entity == "G4Trd")    return RMGGeneratorUtil::rand(dynamic_cast<const G4Trd*>(vol), on_surface);
+  // rebuilding the contour triangulation at every call would be far too slow
+  if (entity == "G4Cons" or entity == "G4Polycone" or entity == "G4GenericPolycone" or entity == "G4Polyhedra") {
+    RMGLog::Out(RMGLog::fatal, "'", entity, "' can only be sampled through RMGGeneratorUtil::MakeSampler()");
   }
+  else RMGLog::Out(RMGLog::fatal, "'", entity, "' is not supported (implement me)");
+  return G4ThreeVector();
 }
 
-G4ThreeVector RMGGeneratorUtil::rand(const G4Box* box, G4bool on_surface) {
+RMGGeneratorUtil::Sampler RMGGeneratorUtil::MakeSampler(const G4VSolid* vol) {
 
-  auto dx = box->GetXHalfLength();
-  auto dy = box->GetYHalfLength();
-  auto dz = box->GetZHalfLength();
+  // resolve the solid type once and copy its dimensions into the closure, the
+  // returned function does not need to touch the solid anymore
+  auto entity = vol->GetEntityType();
+  if (entity == "G4Box") {
+    auto box = dynamic_cast<const G4Box*>(vol);
+    auto dx = box->GetXHalfLength(), dy = box->GetYHalfLength(), dz = box->GetZHalfLength();
+    return [dx, dy, dz](G4bool on_surface) { return SampleBox(dx, dy, dz, on_surface); };
+  }
+  if (entity == "G4Orb") {
+    auto r = dynamic_cast<const G4Orb*>(vol)->GetRadius();
+    return [r](G4bool on_surface) { return SampleSphere(0, r, 0, CLHEP::twopi, 1, -1, on_surface); };
+  }
+  if (entity == "G4Sphere") {
+    auto sphere = dynamic_cast<const G4Sphere*>(vol);
+    auto r1 = sphere->GetInnerRadius(), r2 = sphere->GetOuterRadius();
+    auto phi1 = sphere->GetStartPhiAngle(), delta_phi = sphere->GetDeltaPhiAngle();
+    auto cos_theta1 = sphere->GetCosStartTheta(), cos_theta2 = sphere->GetCosEndTheta();
+    return [=](G4bool on_surface) {
+      return SampleSphere(r1, r2, phi1, delta_phi, cos_theta1, cos_theta2, on_surface);
+    };
+  }
+  if (entity == "G4Tubs") {
+    auto tub = dynamic_cast<const G4Tubs*>(vol);
+    auto r1 = tub->GetInnerRadius(), r2 = tub->GetOuterRadius(), dz = tub->GetZHalfLength();
+    auto phi1 = tub->GetStartPhiAngle(), delta_phi = tub->GetDeltaPhiAngle();
+    return [=](G4bool on_surface) { return SampleTubs(r1, r2, dz, phi1, delta_phi, on_surface); };
+  }
+  if (entity == "G4Trd") {
+    auto trd = dynamic_cast<const G4Trd*>(vol);
+    auto x1 = trd->GetXHalfLength1(), x2 = trd->GetXHalfLength2();
+    auto y1 = trd->GetYHalfLength1(), y2 = trd->GetYHalfLength2();
+    auto dz = trd->GetZHalfLength();
+    return [=](G4bool on_surface) { return SampleTrd(x1, x2, y1, y2, dz, on_surface); };
+  }
 
-  if (on_surface) {
-    auto A1 = 4*dx*dy, A2 = 4*dx*dz, A3 = 4*dy*dz;
-    auto face = _g4rand()*(A1 + A2 + A3);
-    auto face_sign = _g4rand() <= 0.5 ? -1 : 1;
-    G4double x, y, z;
+  // the triangulation and the alias tables are built here, once per process
+  std::shared_ptr<const RZContourSampler> contour_sampler;
+  if (entity == "G4Cons") {
+    auto cons = dynamic_cast<const G4Cons*>(vol);
+    contour_sampler = GetContourSampler(GetRZContour(cons),
+        cons->GetStartPhiAngle(), cons->GetDeltaPhiAngle());
+  }
+  else if (entity == "G4Polycone") {
+    auto polycone = dynamic_cast<const G4Polycone*>(vol);
+    contour_sampler = GetContourSampler(GetRZContour(polycone),
+        polycone->GetStartPhi(), polycone->GetEndPhi() - polycone->GetStartPhi());
+  }
+  else if (entity == "G4GenericPolycone") {
+    auto polycone = dynamic_cast<const G4GenericPolycone*>(vol);
+    contour_sampler = GetContourSampler(GetRZContour(polycone),
+        polycone->GetStartPhi(), polycone->GetEndPhi() - polycone->GetStartPhi());
+  }
+  else if (entity == "G4Polyhedra") {
+    auto polyhedra = dynamic_cast<const G4Polyhedra*>(vol);
+    contour_sampler = GetContourSampler(GetRZContour(polyhedra),
+        polyhedra->GetStartPhi(), polyhedra->GetEndPhi() - polyhedra->GetStartPhi(), polyhedra->GetNumSide());
+  }
+  else RMGLog::Out(RMGLog::fatal, "'", entity, "' is not supported (implement me)");
 
-    if (face <= A1) {
-      x = dx*(2*_g4rand()-1); y = dy*(2*_g4rand()-1); z = dz*face_sign;
-    }
-    else if (face > A1 and face <= A2) {
-      x = dx*(2*_g4rand()-1); y = dy*face_sign; z = dz*(2*_g4rand()-1);
-    }
-    else {
-      x = dx*face_sign; y = dy*(2*_g4rand()-1); z = dz*(2*_g4rand()-1);
-    }
-    return G4ThreeVector(x, y, z);
+  return [contour_sampler](G4bool on_surface) { return contour_sampler->Sample(on_surface); };
+}
+
+RMGGeneratorUtil::Sampler RMGGeneratorUtil::MakeSampler(const BoundingSolid& bounding) {
+
+  auto dx = bounding.half.x(), dy = bounding.half.y(), dz = bounding.half.z();
+  auto r = bounding.radius;
+  if (bounding.type == "Box") {
+    return [dx, dy, dz](G4bool on_surface) { return SampleBox(dx, dy, dz, on_surface); };
   }
-  else {
-    return G4ThreeVector(dx * (2*_g4rand() - 1),
-                         dy * (2*_g4rand() - 1),
-                         dz * (2*_g4rand() - 1));
+  if (bounding.type == "Tube") {
+    return [r, dz](G4bool on_surface) { return SampleTubs(0, r, dz, 0, CLHEP::twopi, on_surface); };
   }
+  return [r](G4bool on_surface) { return SampleSphere(0, r, 0, CLHEP::twopi, 1, -1, on_surface); };
 }
 
-G4ThreeVector RMGGeneratorUtil::rand(const G4Sphere* sphere, G4bool on_surface) {
+RMGGeneratorUtil::UniformBatch::UniformBatch(std::vector<G4double>& buffer) {
+  G4Random::getTheEngine()->flatArray(static_cast<int>(buffer.size()), buffer.data());
+  tUniformsNext = buffer.data();
+  tUniformsEnd = buffer.data() + buffer.size();
+}
 
-  auto r1 = sphere->GetInnerRadius();
-  auto r2 = sphere->GetOuterRadius();
-  auto phi1 = sphere->GetStartPhiAngle();
-  auto delta_phi = sphere->GetDeltaPhiAngle();
-  auto cos_theta1 = sphere->GetCosStartTheta();
-  auto delta_cos_theta = std::abs(sphere->GetCosEndTheta() - cos_theta1);
+RMGGeneratorUtil::UniformBatch::~UniformBatch() {
+  tUniformsNext = nullptr;
+  tUniformsEnd = nullptr;
+}
 
-  auto phi = phi1 + delta_phi * _g4rand();
-  auto cos_theta = delta_cos_theta*_g4rand() + cos_theta1;
-  auto s2_point = G4ThreeVector(std::cos(phi), std::sin(phi), cos_theta) / std::sqrt(1 + cos_theta*cos_theta);
+G4ThreeVector RMGGeneratorUtil::rand(const G4Box* box, G4bool on_surface) {
+  return SampleBox(box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength(), on_surface);
+}
 
-  if (on_surface) {
-    auto A1 = delta_cos_theta*delta_phi*r1*r1;
-    auto A2 = delta_cos_theta*delta_phi*r2*r2;
-    auto side = _g4rand()*(A1+A2);
-    if (side <= A1) return s2_point * r1;
-    else return s2_point * r2;
-  }
-  else {
-    auto R = _g4rand()*(r2-r1) + r1;
-    return s2_point * R;
-  }
+G4ThreeVector RMGGeneratorUtil::rand(const G4Sphere* sphere, G4bool on_surface) {
+  return SampleSphere(sphere->GetInnerRadius(), sphere->GetOuterRadius(),
+      sphere->GetStartPhiAngle(), sphere->GetDeltaPhiAngle(),
+      sphere->GetCosStartTheta(), sphere->GetCosEndTheta(), on_surface);
 }
 
 G4ThreeVector RMGGeneratorUtil::rand(const G4Orb* orb, G4bool on_surface) {
-  return RMGGeneratorUtil::rand(new G4Sphere(orb->GetName(), 0, orb->GetRadius(), 0, CLHEP::twopi, 0, CLHEP::pi), on_surface);
+  return SampleSphere(0, orb->GetRadius(), 0, CLHEP::twopi, 1, -1, on_surface);
 }
 
 G4ThreeVector RMGGeneratorUtil::rand(const G4Tubs* tub, G4bool on_surface) {
+  return SampleTubs(tub->GetInnerRadius(), tub->GetOuterRadius(), tub->GetZHalfLength(),
+      tub->GetStartPhiAngle(), tub->GetDeltaPhiAngle(), on_surface);
+}
 
-  auto r1 = tub->GetInnerRadius();
-  auto r2 = tub->GetOuterRadius();
-  auto h  = 2*tub->GetZHalfLength();
-  auto a = tub->GetStartPhiAngle();
-  auto delta_a = tub->GetDeltaPhiAngle();
-
-  auto phi = a + delta_a * _g4rand();
-  auto z = h * (_g4rand() - 0.5);
-  auto s1_point = G4ThreeVector(std::cos(phi), std::sin(phi), 0);
-
-  if (on_surface) {
-    auto A1 = delta_a*r1*h;
-    auto A2 = delta_a*r2*h;
-    auto A3 = delta_a*(r2*r2 - r1*r1);
-    auto face = _g4rand()*(A1+A2+A3*2);
-    if (face <= A1) return s1_point*r1 + G4ThreeVector(0, 0, z);
-    else if (face > A1 and face <= A2) return s1_point*r2 + G4ThreeVector(0, 0, z);
-    else {
-      auto face_sign = _g4rand() <= 0.5 ? 1 : -1;
-      auto R = _g4rand()*(r2-r1) + r1;
-      return s1_point*R + G4ThreeVector(0, 0, face_sign * h/2);
+G4ThreeVector RMGGeneratorUtil::rand(const G4Trd* trd, G4bool on_surface) {
+  return SampleTrd(trd->GetXHalfLength1(), trd->GetXHalfLength2(), trd->GetYHalfLength1(),
+      trd->GetYHalfLength2(), trd->GetZHalfLength(), on_surface);
+}
+
+/* ========================================================================================== */
+
+RMGGeneratorUtil::RZContourSampler::RZContourSampler(const std::vector<G4TwoVector>& contour,
+    G4double start_phi, G4double delta_phi, G4int n_sides) :
+  fContour(contour),
+  fStartPhi(start_phi),
+  fDeltaPhi(delta_phi),
+  fNSides(n_sides),
+  fPhiCut(delta_phi < CLHEP::twopi - 1E-9),
+  fVolume(0),
+  fSurface(0) {
+
+  if (fContour.size() < 3) RMGLog::Out(RMGLog::fatal, "Degenerate (r, z) contour, cannot sample");
+
+  fTriangles = Triangulate(fContour);
+
+  // volume and area swept by a unit length/area at unit radius
+  auto delta = fNSides > 0 ? fDeltaPhi / fNSides : 0;
+  auto volume_factor = fNSides > 0 ? fNSides * std::sin(delta) : fDeltaPhi;
+
+  std::vector<G4double> volumes, areas;
+  G4double total_area = 0;
+  for (const auto& t : fTriangles) {
+    auto area = 0.5 * std::abs((t[1].x() - t[0].x())*(t[2].y() - t[0].y()) -
+        (t[1].y() - t[0].y())*(t[2].x() - t[0].x()));
+    // Pappus: volume = area x path length of the centroid
+    volumes.push_back(volume_factor * area * (t[0].x() + t[1].x() + t[2].x()) / 3);
+    areas.push_back(area);
+    total_area += area;
+    fVolume += volumes.back();
+  }
+  fVolumeTable.Build(volumes);
+  fAreaTable.Build(areas);
+
+  std::vector<G4double> surfaces;
+  for (size_t i = 0; i < fContour.size(); ++i) {
+    const auto& a = fContour[i];
+    const auto& b = fContour[(i+1) % fContour.size()];
+    auto dr = b.x() - a.x(), dz = b.y() - a.y();
+    G4double length_factor = 0;
+    if (fNSides > 0) {
+      // a polyhedra face is a trapezoid, its chord at unit radius is 2sin(delta/2)
+      auto chord = 2 * std::sin(delta/2);
+      length_factor = fNSides * std::sqrt(dz*dz*chord*chord + dr*dr*std::sin(delta)*std::sin(delta));
     }
+    else length_factor = fDeltaPhi * std::sqrt(dr*dr + dz*dz);
+    surfaces.push_back(length_factor * (a.x() + b.x()) / 2);
   }
-  else {
-    auto R = _g4rand()*(r2-r1) + r1;
-    return s1_point*R + G4ThreeVector(0, 0, z);
+  surfaces.push_back(fPhiCut ? total_area : 0);
+  surfaces.push_back(fPhiCut ? total_area : 0);
+  for (const auto& w : surfaces) fSurface += w;
+  fSurfaceTable.Build(surfaces);
+}
+
+G4ThreeVector RMGGeneratorUtil::RZContourSampler::Sweep(const G4TwoVector& rz, G4double s) const {
+
+  if (fNSides == 0) {
+    auto phi = fStartPhi + s * fDeltaPhi;
+    return G4ThreeVector(rz.x() * std::cos(phi), rz.x() * std::sin(phi), rz.y());
+  }
+
+  // the point lies on the chord between two consecutive corners
+  auto x = s * fNSides;
+  auto j = std::min(static_cast<G4int>(x), fNSides);
+  auto f = x - j;
+  auto delta = fDeltaPhi / fNSides;
+  auto phi1 = fStartPhi + j * delta, phi2 = phi1 + delta;
+
+  return G4ThreeVector(rz.x() * ((1-f) * std::cos(phi1) + f * std::cos(phi2)),
+                       rz.x() * ((1-f) * std::sin(phi1) + f * std::sin(phi2)), rz.y());
+}
+
+G4TwoVector RMGGeneratorUtil::RZContourSampler::SampleTriangle(size_t i, G4bool r_weighted) const {
+
+  const auto& t = fTriangles[i];
+
+  if (!r_weighted) {
+    auto a = std::sqrt(_g4rand()), b = _g4rand();
+    return (1-a) * t[0] + a*(1-b) * t[1] + a*b * t[2];
   }
+
+  // a density linear in r is the mixture of the Dirichlet(2,1,1)
+  // distributions of the barycentric coordinates, weighted by the radii of
+  // the corners
+  auto sum_r = t[0].x() + t[1].x() + t[2].x();
+  auto x = _g4rand() * sum_r;
+  size_t k = x < t[0].x() ? 0 : (x < t[0].x() + t[1].x() ? 1 : 2);
+
+  std::array<G4double, 3> g = {-std::log(_g4rand()), -std::log(_g4rand()), -std::log(_g4rand())};
+  g[k] -= std::log(_g4rand());
+  auto norm = g[0] + g[1] + g[2];
+
+  return (g[0] * t[0] + g[1] * t[1] + g[2] * t[2]) / norm;
+}
+
+G4ThreeVector RMGGeneratorUtil::RZContourSampler::Sample(G4bool on_surface) const {
+
+  if (!on_surface) return this->Sweep(this->SampleTriangle(fVolumeTable.Sample(_g4rand()), true), _g4rand());
+
+  auto face = fSurfaceTable.Sample(_g4rand());
+
+  // phi cuts
+  if (face >= fContour.size()) {
+    return this->Sweep(this->SampleTriangle(fAreaTable.Sample(_g4rand()), false), face == fContour.size() ? 0 : 1);
+  }
+
+  // swept contour edge, density linear in r along the edge
+  const auto& a = fContour[face];
+  const auto& b = fContour[(face+1) % fContour.size()];
+  G4double t;
+  if (_g4rand()*(a.x() + b.x()) < a.x()) t = 1 - std::sqrt(_g4rand());
+  else t = std::sqrt(_g4rand());
+
+  return this->Sweep(a + t*(b - a), _g4rand());
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,83 @@
+#include "RMGGeneratorVertexFile.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Randomize.hh"
+
+#include "RMGGeneratorVertexFileMessenger.hh"
+#include "RMGLog.hh"
+
+constexpr const char* RMGGeneratorVertexFile::kMagic;
+constexpr std::uint32_t RMGGeneratorVertexFile::kVersion;
+
+RMGGeneratorVertexFile::RMGGeneratorVertexFile() :
+  RMGVGeneratorPrimaryPosition("VertexFile"),
+  fVertices(nullptr),
+  fNVertices(0),
+  fCursor(0),
+  fIndependentEvents(false),
+  fRandomizeCursor(false) {
+
+  fG4Messenger = std::unique_ptr<RMGGeneratorVertexFileMessenger>(new RMGGeneratorVertexFileMessenger(this));
+}
+
+void RMGGeneratorVertexFile::OpenFile() {
+
+  if (fFileName.empty()) RMGLog::Out(RMGLog::fatal, "No vertex file name specified");
+  if (!fFile.Open(fFileName)) RMGLog::Out(RMGLog::fatal, "Could not open vertex file '", fFileName, "'");
+
+  VertexFileHeader header;
+  if (fFile.GetSize() < sizeof(header)) {
+    RMGLog::Out(RMGLog::fatal, "Vertex file '", fFileName, "' is too short");
+  }
+  std::memcpy(&header, fFile.GetData(), sizeof(header));
+
+  if (std::strncmp(header.magic, kMagic, sizeof(header.magic)) != 0) {
+    RMGLog::Out(RMGLog::fatal, "'", fFileName, "' is not a remage vertex file");
+  }
+  if (header.version != kVersion or header.record_size != 3*sizeof(G4double)) {
+    RMGLog::Out(RMGLog::fatal, "Vertex file '", fFileName, "' has unsupported format version ",
+        header.version, " (record size ", header.record_size, " bytes)");
+  }
+  if (header.n_vertices == 0 or
+      fFile.GetSize() < sizeof(header) + header.n_vertices * header.record_size) {
+    RMGLog::Out(RMGLog::fatal, "Vertex file '", fFileName, "' is empty or truncated");
+  }
+
+  // the header is 24 bytes long, the records are properly aligned
+  fVertices = reinterpret_cast<const G4double*>(fFile.GetData() + sizeof(header));
+  fNVertices = header.n_vertices;
+  fReplayCursor = RMGReplayCursor::Get(fFileName, fNVertices);
+
+  RMGLog::Out(RMGLog::detail, "Replaying ", fNVertices, " vertices from file '", fFileName, "'");
+}
+
+G4ThreeVector RMGGeneratorVertexFile::ShootPrimaryPosition() {
+
+  if (!fFile.IsOpen()) this->OpenFile();
+
+  std::uint64_t i = 0;
+  G4bool first_repeat = false;
+  if (fIndependentEvents) {
+    if (fRandomizeCursor) {
+      fCursor = std::min<std::uint64_t>(G4UniformRand() * fNVertices, fNVertices - 1);
+      fRandomizeCursor = false;
+    }
+    i = fCursor;
+    if (++fCursor == fNVertices) fCursor = 0;
+    first_repeat = fReplayCursor->Count();
+  }
+  else i = fReplayCursor->Next(first_repeat);
+
+  if (first_repeat) {
+    RMGLog::Out(RMGLog::warning, "All the ", fNVertices, " vertices in '", fFileName,
+        "' have been used, vertices will be repeated from now on");
+  }
+
+  auto v = fVertices + 3*i;
+
+  return G4ThreeVector(v[0], v[1], v[2]);
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,23 @@
+#include "RMGGeneratorVertexFileMessenger.hh"
+
+#include "RMGGeneratorVertexFile.hh"
+#include "RMGTools.hh"
+#include "RMGLog.hh"
+
+RMGGeneratorVertexFileMessenger::RMGGeneratorVertexFileMessenger(RMGGeneratorVertexFile* generator) :
+  fGenerator(generator) {
+
+  G4String directory = "/RMG/Generators/VertexFile";
+  fDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
+
+  fFileNameCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/FileName", this, "",
+      {G4State_PreInit, G4State_Init, G4State_Idle});
+}
+
+void RMGGeneratorVertexFileMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
+
+  if (cmd == fFileNameCmd.get()) fGenerator->SetFileName(new_values);
+  else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), " not known");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,6 +1,18 @@
 #include "RMGGeneratorVolumeConfinement.hh"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
 #include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPVParameterisation.hh"
 #include "G4PhysicalVolumeStore.hh"
 #include "G4Tubs.hh"
 #include "G4Sphere.hh"
@@ -9,79 +21,282 @@
 #include "G4SubtractionSolid.hh"
 #include "G4VisExtent.hh"
 #include "G4TransportationManager.hh"
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
 #include "Randomize.hh"
 
 #include "RMGGeneratorVolumeConfinementMessenger.hh"
+#include "RMGGeneratorVertexFile.hh"
 #include "RMGGeneratorUtil.hh"
 #include "RMGLog.hh"
 #include "RMGNavigationTools.hh"
+#include "RMGTouchableTransformTable.hh"
 #include "RMGManager.hh"
+#include "RMGRun.hh"
+
+namespace {
+
+  // below this number of names spawning threads is not worth it
+  const size_t kParallelMatchThreshold = 2048;
+
+  // match all the names against a compiled pattern, splitting the list among
+  // threads if it is long. Matching does not modify the regex object, it is
+  // safe to share it
+  std::vector<char> MatchNames(const std::vector<G4String>& names, const std::regex& regex) {
+
+    std::vector<char> matches(names.size(), 0);
+    auto match_range = [&names, &regex, &matches](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) matches[i] = std::regex_match(names[i], regex);
+    };
+
+    size_t n_threads = std::thread::hardware_concurrency();
+    if (names.size() < kParallelMatchThreshold or n_threads < 2) {
+      match_range(0, names.size());
+      return matches;
+    }
+
+    std::vector<std::thread> threads;
+    auto chunk = (names.size() + n_threads - 1) / n_threads;
+    for (size_t begin = 0; begin < names.size(); begin += chunk) {
+      threads.emplace_back(match_range, begin, std::min(begin + chunk, names.size()));
+    }
+    for (auto& t : threads) t.join();
+
+    return matches;
+  }
+
+  // the volume store indexed by name, placements sharing a name (e.g. the
+  // copies of a detector) are matched against a name pattern only once. The
+  // index and the matches of each pattern are built once for the whole
+  // process and shared read-only: the first thread asking for a pattern
+  // matches it (in parallel, the other workers block on it anyway), the
+  // others reuse the result
+  struct NameIndex {
+    size_t store_size = 0;
+    std::vector<G4String> names;
+    std::vector<std::vector<G4VPhysicalVolume*>> volumes_by_name;
+
+    G4Mutex matches_mutex = G4MUTEX_INITIALIZER;
+    std::map<std::string, std::shared_ptr<const std::vector<char>>> matches; // by name pattern
+  };
+
+  G4Mutex gNameIndexMutex = G4MUTEX_INITIALIZER;
+  std::shared_ptr<NameIndex> gNameIndex;
+
+  // rebuilt if the store changed, e.g. after a geometry reload between runs
+  std::shared_ptr<NameIndex> GetNameIndex() {
+
+    G4AutoLock lock(&gNameIndexMutex);
+    auto store = G4PhysicalVolumeStore::GetInstance();
+    if (gNameIndex and gNameIndex->store_size == store->size()) return gNameIndex;
+
+    auto index = std::make_shared<NameIndex>();
+    index->store_size = store->size();
+    std::unordered_map<std::string, size_t> name_index;
+    for (const auto& v : *store) {
+      auto res = name_index.emplace(v->GetName(), index->names.size());
+      if (res.second) {
+        index->names.push_back(v->GetName());
+        index->volumes_by_name.emplace_back();
+      }
+      index->volumes_by_name[res.first->second].push_back(v);
+    }
+    gNameIndex = index;
+    return gNameIndex;
+  }
+
+  std::shared_ptr<const std::vector<char>> MatchPattern(NameIndex& index,
+      const std::string& pattern, const std::regex& regex) {
+
+    G4AutoLock lock(&index.matches_mutex);
+    auto& matches = index.matches[pattern];
+    if (!matches) matches = std::make_shared<const std::vector<char>>(MatchNames(index.names, regex));
+    return matches;
+  }
+}
 
 RMGGeneratorVolumeConfinement::SampleableObject::SampleableObject(
   G4VPhysicalVolume* v, G4RotationMatrix r, G4ThreeVector t, G4VSolid* s):
 
   rotation(r),
   translation(t),
-  containment_check(true) {
+  inverse_rotation(r.inverse()),
+  copy_no(v ? v->GetCopyNo() : 0),
+  containment_check(true),
+  navigator_only(false) {
 
   if (!v and !s) RMGLog::Out(RMGLog::error, "Invalid pointers given to constructor");
 
   physical_volume = v;
   sampling_solid = s;
 
-  if (physical_volume) volume = physical_volume->GetLogicalVolume()->GetSolid()->GetCubicVolume();
-  else volume = sampling_solid->GetCubicVolume();
-}
+  // cache the daughter placements, points inside them do not belong to this
+  // volume. Parameterised placements can change shape and replicated
+  // daughters are not fixed in space, leave them to the navigator
+  if (physical_volume) {
+    if (physical_volume->IsParameterised()) navigator_only = true;
+    auto log_vol = physical_volume->GetLogicalVolume();
+    for (G4int i = 0; i < log_vol->GetNoDaughters(); ++i) {
+      auto d = log_vol->GetDaughter(i);
+      if (d->IsReplicated()) {
+        navigator_only = true;
+        break;
+      }
+      daughters.push_back({d->GetLogicalVolume()->GetSolid(),
+          d->GetObjectRotationValue().inverse(), d->GetObjectTranslation()});
+    }
+  }
 
-RMGGeneratorVolumeConfinement::SampleableObject::~SampleableObject() {
-  if (sampling_solid and sampling_solid != physical_volume->GetLogicalVolume()->GetSolid()) {
-    delete sampling_solid;
+  if (physical_volume) {
+    volume = physical_volume->GetLogicalVolume()->GetSolid()->GetCubicVolume();
+    surface = physical_volume->GetLogicalVolume()->GetSolid()->GetSurfaceArea();
+  }
+  else {
+    volume = sampling_solid->GetCubicVolume();
+    surface = sampling_solid->GetSurfaceArea();
   }
 }
 
-const RMGGeneratorVolumeConfinement::SampleableObject& RMGGeneratorVolumeConfinement::SampleableObjectCollection::SurfaceWeightedRand() {
-  auto choice = total_surface * G4UniformRand();
-  G4double w = 0;
+void RMGGeneratorVolumeConfinement::SampleableObjectCollection::BuildAliasTables() {
+
+  std::vector<G4double> volumes, surfaces;
+  volumes.reserve(data.size());
+  surfaces.reserve(data.size());
+  // the volumes of parameterised copies are known only after initialization,
+  // recompute the totals here
+  total_volume = 0;
+  total_surface = 0;
   for (const auto& o : data) {
-    if (choice > w and choice <= w+o.surface) return o;
-    w += o.surface;
-    if (w >= total_surface) {
-      RMGLog::Out(RMGLog::error, "Sampling from collection of sampleables unespectedly failed ",
-          "(out-of-range error). Returning last object");
-      return data.back();
-    }
+    volumes.push_back(o.volume);
+    surfaces.push_back(o.surface);
+    total_volume += o.volume;
+    total_surface += o.surface;
   }
-  return data.back();
+
+  volume_alias_table.Build(volumes);
+  surface_alias_table.Build(surfaces);
 }
 
-const RMGGeneratorVolumeConfinement::SampleableObject& RMGGeneratorVolumeConfinement::SampleableObjectCollection::VolumeWeightedRand() {
-  auto choice = total_volume * G4UniformRand();
-  G4double w = 0;
-  for (const auto& o : data) {
-    if (choice > w and choice <= w+o.volume) return o;
-    w += o.volume;
-    if (w >= total_surface) {
-      RMGLog::Out(RMGLog::error, "Sampling from collection of sampleables unespectedly failed ",
-          "(out-of-range error). Returning last object");
-      return data.back();
-    }
+RMGGeneratorVolumeConfinement::SampleableObject& RMGGeneratorVolumeConfinement::SampleableObjectCollection::SurfaceWeightedRand() {
+
+  if (data.empty()) RMGLog::Out(RMGLog::fatal, "Cannot sample from an empty collection of sampleables");
+  if (surface_alias_table.size() != data.size()) this->BuildAliasTables();
+
+  return data[surface_alias_table.Sample()];
+}
+
+RMGGeneratorVolumeConfinement::SampleableObject& RMGGeneratorVolumeConfinement::SampleableObjectCollection::VolumeWeightedRand() {
+
+  if (data.empty()) RMGLog::Out(RMGLog::fatal, "Cannot sample from an empty collection of sampleables");
+  if (volume_alias_table.size() != data.size()) this->BuildAliasTables();
+
+  return data[volume_alias_table.Sample()];
+}
+
+void RMGGeneratorVolumeConfinement::SampleableObject::SetTransformation(const G4RotationMatrix& r,
+    const G4ThreeVector& t) {
+  rotation = r;
+  translation = t;
+  inverse_rotation = r.inverse();
+}
+
+EInside RMGGeneratorVolumeConfinement::SampleableObject::Inside(const G4ThreeVector& vertex,
+    G4bool on_surface) const {
+  return this->InsideLocalFrame(inverse_rotation * (vertex - translation), on_surface);
+}
+
+EInside RMGGeneratorVolumeConfinement::SampleableObject::InsideLocalFrame(const G4ThreeVector& local,
+    G4bool on_surface) const {
+
+  // geometrical volumes have no daughters, the test is exact
+  if (!physical_volume) return sampling_solid->Inside(local) == kOutside ? kOutside : kInside;
+
+  if (navigator_only) return kSurface;
+
+  // points sampled on the surface are on the solid by construction, just make
+  // sure they are not covered by a daughter
+  if (!on_surface) {
+    auto in = physical_volume->GetLogicalVolume()->GetSolid()->Inside(local);
+    if (in != kInside) return in;
+  }
+
+  for (const auto& d : daughters) {
+    auto in_daughter = d.solid->Inside(d.inverse_rotation * (local - d.translation));
+    if (in_daughter == kInside) return kOutside;
+    if (in_daughter == kSurface) return on_surface ? kOutside : kSurface;
+  }
+
+  return kInside;
+}
+
+G4String RMGGeneratorVolumeConfinement::SampleableObject::GetName() const {
+  if (physical_volume) return physical_volume->GetName() + "[" + std::to_string(copy_no) + "]";
+  else return sampling_solid->GetEntityType();
+}
+
+RMGAcceptanceGrid::CellType RMGGeneratorVolumeConfinement::SampleableObject::ClassifyCell(
+    const G4ThreeVector& center, G4double half_diagonal) const {
+
+  // safety distances are underestimates, hence the classification is
+  // conservative: when in doubt the cell is a boundary one
+  auto solid = physical_volume->GetLogicalVolume()->GetSolid();
+  auto in = solid->Inside(center);
+  if (in == kOutside) {
+    return solid->DistanceToIn(center) > half_diagonal ?
+      RMGAcceptanceGrid::kOutsideCell : RMGAcceptanceGrid::kBoundaryCell;
+  }
+  if (in == kSurface or solid->DistanceToOut(center) <= half_diagonal) return RMGAcceptanceGrid::kBoundaryCell;
+
+  for (const auto& d : daughters) {
+    auto local = d.inverse_rotation * (center - d.translation);
+    auto in_daughter = d.solid->Inside(local);
+    if (in_daughter == kInside and d.solid->DistanceToOut(local) > half_diagonal) return RMGAcceptanceGrid::kOutsideCell;
+    if (in_daughter != kOutside or d.solid->DistanceToIn(local) <= half_diagonal) return RMGAcceptanceGrid::kBoundaryCell;
+  }
+
+  return RMGAcceptanceGrid::kInsideCell;
+}
+
+std::uint64_t RMGGeneratorVolumeConfinement::SampleableObject::GeometryHash() const {
+
+  std::ostringstream ss;
+  ss.precision(17);
+  physical_volume->GetLogicalVolume()->GetSolid()->StreamInfo(ss);
+  for (const auto& d : daughters) {
+    d.solid->StreamInfo(ss);
+    ss << d.inverse_rotation << d.translation;
   }
-  return data.back();
+  return RMGAcceptanceGrid::Hash(ss.str());
 }
 
 G4bool RMGGeneratorVolumeConfinement::SampleableObjectCollection::IsInside(const G4ThreeVector& vertex) {
-  auto navigator = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
+
   for (const auto& o : data) {
-    if (o.physical_volume) {
-      if (navigator->LocateGlobalPointAndSetup(vertex) == o.physical_volume) return true;
-    }
-    else {
-      if (o.sampling_solid->Inside(o.rotation.inverse() * vertex - o.translation)) return true;
-    }
+    auto in = o.Inside(vertex);
+    if (in == kInside) return true;
+    if (in == kSurface and this->IsInsideWithNavigator(o, vertex)) return true;
   }
   return false;
 }
 
+G4bool RMGGeneratorVolumeConfinement::SampleableObjectCollection::IsInsideWithNavigator(
+    const SampleableObject& o, const G4ThreeVector& vertex) {
+
+  if (!o.physical_volume) return o.Inside(vertex) != kOutside;
+
+  if (!navigator) {
+    auto world_volume = G4TransportationManager::GetTransportationManager()
+      ->GetNavigatorForTracking()->GetWorldVolume();
+    if (!world_volume) RMGLog::Out(RMGLog::fatal, "World volume not defined");
+    navigator = std::unique_ptr<G4Navigator>(new G4Navigator());
+    navigator->SetWorldVolume(world_volume);
+  }
+
+  // the navigator sets the copy number of replicated volumes to the one of the
+  // located copy
+  auto located = navigator->LocateGlobalPointAndSetup(vertex, nullptr, false, true);
+  return located == o.physical_volume and (!located->IsReplicated() or located->GetCopyNo() == o.copy_no);
+}
 
 void RMGGeneratorVolumeConfinement::SampleableObjectCollection::emplace_back(G4VPhysicalVolume* v, G4RotationMatrix& r, G4ThreeVector& t, G4VSolid* s) {
   data.emplace_back(v, r, t, s);
@@ -97,45 +312,90 @@ void RMGGeneratorVolumeConfinement::SampleableObjectCollection::emplace_back(G4V
 
 /* ========================================================================================== */
 
-RMGGeneratorVolumeConfinement::RMGGeneratorVolumeConfinement() :
+RMGGeneratorVolumeConfinement::RMGGeneratorVolumeConfinement(G4bool with_messenger) :
   RMGVGeneratorPrimaryPosition("VolumeConfinement"),
   fSamplingMode(SamplingMode::kUnionAll),
   fOnSurface(false),
-  fBoundingSolidType("Sphere") {
-
-  fG4Messenger = std::unique_ptr<RMGGeneratorVolumeConfinementMessenger>(new RMGGeneratorVolumeConfinementMessenger(this));
+  fBoundingSolidType("Auto"),
+  fGridResolution(0),
+  fVertexBatchSize(64),
+  fRun(nullptr) {
+
+  fLocalCandidates.resize(fVertexBatchSize);
+  // enough for the volume sampling of all the closed-form solids
+  fUniforms.resize(4*fVertexBatchSize);
+  RMGRun::RegisterSummary("Confinement", &RMGGeneratorVolumeConfinement::PrintRunSummary);
+
+  if (with_messenger) {
+    fG4Messenger = std::unique_ptr<RMGGeneratorVolumeConfinementMessenger>(new RMGGeneratorVolumeConfinementMessenger(this));
+  }
 }
 
 void RMGGeneratorVolumeConfinement::InitializePhysicalVolumes() {
 
-  if (!fPhysicalVolumes.empty()) return;
+  if (!fPhysicalVolumes.empty() or fPhysicalVolumeNameRegexes.empty()) return;
 
-  auto volume_store = G4PhysicalVolumeStore::GetInstance();
+  auto index = GetNameIndex();
+  const auto& names = index->names;
+  const auto& volumes_by_name = index->volumes_by_name;
 
   // scan all search patterns provided by the user
+  std::vector<std::shared_ptr<const std::vector<char>>> name_matches(fPhysicalVolumeNameRegexes.size());
+  std::vector<std::regex> copy_nr_regexes(fPhysicalVolumeNameRegexes.size());
+  std::vector<const G4VPhysicalVolume*> matched_volumes;
   for (size_t i = 0; i < fPhysicalVolumeNameRegexes.size(); ++i) {
     RMGLog::OutFormat(RMGLog::detail, "Physical volumes matching pattern '%s'['%s']",
         fPhysicalVolumeNameRegexes.at(i).c_str(), fPhysicalVolumeCopyNrRegexes.at(i).c_str());
 
-    G4bool found = false;
-    // scan the volume store for matches
-    for (auto&& it = volume_store->begin(); it != volume_store->end(); it++) {
-      if (std::regex_match((*it)->GetName(), std::regex(fPhysicalVolumeNameRegexes.at(i))) and
-          std::regex_match(std::to_string((*it)->GetCopyNo()), std::regex(fPhysicalVolumeCopyNrRegexes.at(i)))) {
+    // compile the patterns once
+    std::regex name_regex;
+    try {
+      name_regex = std::regex(fPhysicalVolumeNameRegexes.at(i));
+      copy_nr_regexes[i] = std::regex(fPhysicalVolumeCopyNrRegexes.at(i));
+    }
+    catch (const std::regex_error& e) {
+      RMGLog::Out(RMGLog::fatal, "Invalid physical volume pattern '", fPhysicalVolumeNameRegexes.at(i),
+          "'['", fPhysicalVolumeCopyNrRegexes.at(i), "']: ", e.what());
+    }
 
-        fPhysicalVolumes.emplace_back(*it, G4RotationMatrix(), G4ThreeVector(), nullptr);
+    name_matches[i] = MatchPattern(*index, fPhysicalVolumeNameRegexes.at(i), name_regex);
+    for (size_t j = 0; j < names.size(); ++j) {
+      if ((*name_matches[i])[j]) matched_volumes.insert(matched_volumes.end(),
+          volumes_by_name[j].begin(), volumes_by_name[j].end());
+    }
+  }
 
-        RMGLog::OutFormat(RMGLog::detail, "Mass of '%s[%s]' = %g kg", (*it)->GetName().c_str(),
-            (*it)->GetCopyNo(), fPhysicalVolumes.data.back().volume/CLHEP::kg);
+  // only the branches of the geometry tree leading to the matched volumes
+  // are expanded. This thread is not tracking yet, moving its replicated and
+  // parameterised volumes around while building is harmless
+  auto touchables = RMGTouchableTransformTable::Get(matched_volumes);
 
-        found = true;
-      }
-      if (!found) {
-        RMGLog::Out(RMGLog::warning, "No physical volumes names found matching pattern '",
-            fPhysicalVolumeNameRegexes.at(i), "' and copy numbers matching pattern '",
-            fPhysicalVolumeCopyNrRegexes.at(i), "'");
+  for (size_t i = 0; i < fPhysicalVolumeNameRegexes.size(); ++i) {
+    G4bool found = false;
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (!(*name_matches[i])[j]) continue;
+      for (const auto& v : volumes_by_name[j]) {
+        // one object per touchable: each copy of a replicated or
+        // parameterised volume, each placement of the mother volume
+        for (auto k : touchables->Find(v)) {
+          const auto& t = touchables->GetTouchable(k);
+          if (!std::regex_match(std::to_string(t.copy_no), copy_nr_regexes[i])) continue;
+
+          fPhysicalVolumes.emplace_back(v, t.rotation, t.translation, nullptr);
+          fPhysicalVolumes.back().copy_no = t.copy_no;
+
+          RMGLog::OutFormat(RMGLog::detail, "Volume of '%s[%d]' = %g cm3", v->GetName().c_str(),
+              t.copy_no, fPhysicalVolumes.data.back().volume/CLHEP::cm3);
+
+          found = true;
+        }
       }
     }
+    if (!found) {
+      RMGLog::Out(RMGLog::warning, "No physical volumes names found matching pattern '",
+          fPhysicalVolumeNameRegexes.at(i), "' and copy numbers matching pattern '",
+          fPhysicalVolumeCopyNrRegexes.at(i), "'");
+    }
   }
 
   if (fPhysicalVolumes.empty()) {
@@ -156,15 +416,37 @@ void RMGGeneratorVolumeConfinement::InitializePhysicalVolumes() {
 
     auto log_vol = el.physical_volume->GetLogicalVolume();
     auto solid = log_vol->GetSolid();
-    auto solid_type = log_vol->GetSolid()->GetEntityType();
+
+    // the copies of a radial replica are shells of different radii sharing
+    // one solid, whose dimensions are only set by the navigator
+    if (el.physical_volume->IsReplicated() and !el.physical_volume->IsParameterised()) {
+      EAxis axis; G4int n_copies; G4double width, offset; G4bool consuming;
+      el.physical_volume->GetReplicationData(axis, n_copies, width, offset, consuming);
+      if (axis == kRho) {
+        RMGLog::Out(RMGLog::fatal, "Sampling in the radial replica '", el.GetName(),
+            "' is not supported");
+      }
+    }
+
+    // the solid of a parameterised volume depends on the copy. The sampler
+    // built below copies the dimensions, set them for this copy first
+    if (el.physical_volume->IsParameterised()) {
+      auto param = el.physical_volume->GetParameterisation();
+      solid = param->ComputeSolid(el.copy_no, el.physical_volume);
+      solid->ComputeDimensions(param, el.copy_no, el.physical_volume);
+      el.volume = solid->GetCubicVolume();
+      el.surface = solid->GetSurfaceArea();
+    }
+
+    auto solid_type = solid->GetEntityType();
 
     // if the solid is simple one can avoid using bounding volumes for sampling
     // both volume and native surface sampling are available
     if (RMGGeneratorUtil::IsSampleable(solid_type)) {
       el.sampling_solid = solid;
+      el.sampler = RMGGeneratorUtil::MakeSampler(solid);
       // if there are no daugthers one can avoid doing containment checks
-      if (log_vol->GetNoDaughters()) el.containment_check = false;
-      else el.containment_check = true;
+      el.containment_check = log_vol->GetNoDaughters() > 0;
     }
     // if it's not sampleable, cannot perform native surface sampling
     else if (fOnSurface) {
@@ -173,70 +455,50 @@ void RMGGeneratorVolumeConfinement::InitializePhysicalVolumes() {
     }
     // if we have a subtraction solid and the first one is supported for
     // sampling, use it but check for containment
-    else if (solid_type == "G4SubtractionSolid") {
-      if (RMGGeneratorUtil::IsSampleable(solid->GetConstituentSolid(0)->GetEntityType())) {
-        el.sampling_solid = solid->GetConstituentSolid(0);
-        el.containment_check = true;
-      }
+    else if (solid_type == "G4SubtractionSolid" and
+        RMGGeneratorUtil::IsSampleable(solid->GetConstituentSolid(0)->GetEntityType())) {
+      el.sampling_solid = solid->GetConstituentSolid(0);
+      el.sampler = RMGGeneratorUtil::MakeSampler(el.sampling_solid);
+      el.containment_check = true;
     }
-    // use bounding solid for all other cases
+    // use bounding solid for all other cases. Only its dimensions are needed,
+    // no solid is created (nor registered in the store) by each thread
     else {
       el.containment_check = true;
-      auto solid_extent = solid->GetExtent(); // do not call multiple times, the function does not cache the result!
-      if (fBoundingSolidType == "Sphere") {
-        el.sampling_solid = new G4Orb("RMGGeneratorVolumeConfinement::fBoundingSphere", solid_extent.GetExtentRadius());
-      }
-      else if (fBoundingSolidType == "Box") {
-        el.sampling_solid = new G4Box("RMGGeneratorVolumeConfinement::fBoundingBox",
-            solid_extent.GetXmax() - solid_extent.GetXmin(),
-            solid_extent.GetYmax() - solid_extent.GetYmin(),
-            solid_extent.GetZmax() - solid_extent.GetZmin());
-      }
-      else {
-        RMGLog::Out(RMGLog::fatal, "Bounding solid type '", fBoundingSolidType,
-            "' not supported (implement me)");
-      }
+      auto bounding = RMGGeneratorUtil::MakeBoundingSolid(solid, fBoundingSolidType);
+      el.sampling_solid = nullptr;
+      el.sampling_offset = bounding.offset;
+      el.sampler = RMGGeneratorUtil::MakeSampler(bounding);
+      RMGLog::OutFormat(RMGLog::detail, "Sampling '%s' through a bounding %s, predicted efficiency %.1f%%",
+          el.GetName().c_str(), bounding.type.c_str(), 100 * el.volume / bounding.volume);
     }
 
-    // determine solid transformation w.r.t. world volume reference
-
-    G4ThreeVector vol_global_translation; // origin
-    G4RotationMatrix vol_global_rotation; // identity
-    std::vector<G4RotationMatrix> partial_rotations;
-    std::vector<G4ThreeVector> partial_translations;
+    if (fGridResolution > 0 and !fOnSurface and el.containment_check and !el.navigator_only) {
+      this->BuildAcceptanceGrid(el);
+    }
+  }
 
-    for (auto v = el.physical_volume; v != world_volume; v = RMGNavigationTools::FindDirectMother(v)) {
+  fPhysicalVolumes.BuildAliasTables();
+}
 
-      if (!v) RMGLog::Out(RMGLog::fatal, "nullptr detected in loop condition, this is unexpected. ",
-          "Blame RMGPhysVolNavigator::FindDirectMother?");
+void RMGGeneratorVolumeConfinement::BuildAcceptanceGrid(SampleableObject& o) {
 
-      partial_rotations.emplace_back(*(v->GetObjectRotation()));
-      partial_translations.push_back(v->GetObjectTranslation());
+  G4ThreeVector pmin, pmax;
+  o.physical_volume->GetLogicalVolume()->GetSolid()->BoundingLimits(pmin, pmax);
 
-      vol_global_rotation = partial_rotations.back() * vol_global_rotation;
-    }
-    // world volume not included in loop
-    partial_rotations.emplace_back();
-    partial_translations.emplace_back(0, 0, 0);
-
-    // partial_rotations[0] and partial_translations[0] refer to the target
-    // volume partial_rotations[1] and partial_translations[1], to the direct
-    // mother, etc. It is necessary to rotate with respect to the frame of the
-    // mother. If there are no rotations (or only the target volume is
-    // rotated): rotations are identity matrices and vol_global_translation =
-    // sum(partial_translations)
-    for (size_t i = 0; i < partial_translations.size()-1; i++) {
-      G4ThreeVector tmp = partial_translations[i];
-      for (size_t j = i+1; j < partial_rotations.size()-1; j++) {
-        tmp *= partial_rotations[j];
-      }
-      vol_global_translation += tmp;
-    }
+  o.grid = RMGAcceptanceGrid::BuildShared(pmin, pmax, fGridResolution,
+      [&o](const G4ThreeVector& c, G4double h) { return o.ClassifyCell(c, h); },
+      o.GeometryHash(), fGridCacheDirectory);
 
-    // assign transformation to sampling solid
-    el.rotation = vol_global_rotation;
-    el.translation = vol_global_translation;
+  if (o.grid->empty()) {
+    RMGLog::Out(RMGLog::warning, "Acceptance grid of '", o.GetName(), "' is empty, not using it");
+    o.grid.reset();
+    return;
   }
+
+  RMGLog::OutFormat(RMGLog::detail, "Sampling '%s' through an acceptance grid (%zu inside, %zu boundary cells), "
+      "predicted efficiency %.1f%%", o.GetName().c_str(), o.grid->GetNInsideCells(),
+      o.grid->GetNBoundaryCells(), 100 * o.volume / o.grid->GetSampledVolume());
 }
 
 void RMGGeneratorVolumeConfinement::InitializeGeometricalVolumes() {
@@ -270,6 +532,10 @@ void RMGGeneratorVolumeConfinement::InitializeGeometricalVolumes() {
         fGeomVolumeSolids.back().volume/CLHEP::cm3,
         fGeomVolumeSolids.back().surface/CLHEP::cm2);
   }
+
+  for (auto& o : fGeomVolumeSolids.data) o.sampler = RMGGeneratorUtil::MakeSampler(o.sampling_solid);
+
+  fGeomVolumeSolids.BuildAliasTables();
 }
 
 void RMGGeneratorVolumeConfinement::Reset() {
@@ -280,7 +546,79 @@ void RMGGeneratorVolumeConfinement::Reset() {
   fGeomVolumeSolids.clear();
   fSamplingMode = RMGGeneratorVolumeConfinement::kUnionAll;
   fOnSurface = false;
-  fBoundingSolidType = "Sphere";
+  fBoundingSolidType = "Auto";
+  fGridResolution = 0;
+  fGridCacheDirectory = "";
+}
+
+void RMGGeneratorVolumeConfinement::FillVertexBuffer(SampleableObject& o,
+    SampleableObjectCollection& collection) {
+
+  auto is_inside = [&](const G4ThreeVector& c) {
+    auto in = o.InsideLocalFrame(c, fOnSurface);
+    if (in == kSurface) return collection.IsInsideWithNavigator(o, o.translation + o.rotation * c);
+    return in == kInside;
+  };
+
+  size_t n_accepted = 0;
+  if (o.grid and !fOnSurface) {
+    // only candidates falling in boundary cells need a containment check
+    G4bool needs_check = false;
+    for (size_t i = 0; i < fLocalCandidates.size(); ++i) {
+      auto c = o.grid->Sample(needs_check);
+      if (!needs_check or is_inside(c)) fLocalCandidates[n_accepted++] = c;
+    }
+  }
+  else {
+    // draw a whole batch of candidates in the local frame of the object first,
+    // such that sampling, rejection and transformation run as tight loops.
+    // The random numbers of the batch come from a single engine call
+    {
+      RMGGeneratorUtil::UniformBatch uniforms(fUniforms);
+      for (auto& c : fLocalCandidates) c = o.sampler(fOnSurface) + o.sampling_offset;
+    }
+
+    n_accepted = fLocalCandidates.size();
+    if (o.containment_check) {
+      n_accepted = 0;
+      for (const auto& c : fLocalCandidates) {
+        if (is_inside(c)) fLocalCandidates[n_accepted++] = c;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n_accepted; ++i) {
+    o.vertex_buffer.push_back(o.translation + o.rotation * fLocalCandidates[i]);
+  }
+
+  // the worker runs are merged before their end of run action, count in the
+  // run directly
+  if (fRun and !o.run_n_trials) {
+    auto name = "Confinement/" + G4String(fOnSurface ? "surface/" : "volume/") + o.GetName();
+    o.run_n_trials = &fRun->GetCounter(name + "/n_trials");
+    o.run_n_accepted = &fRun->GetCounter(name + "/n_accepted");
+  }
+  if (o.run_n_trials) {
+    *o.run_n_trials += fLocalCandidates.size();
+    *o.run_n_accepted += n_accepted;
+  }
+}
+
+G4bool RMGGeneratorVolumeConfinement::ShootInObject(SampleableObject& o,
+    SampleableObjectCollection& collection, G4ThreeVector& vertex, G4int& calls) {
+
+  // the buffer only ever holds vertices accepted for this very object, they
+  // are independent and uniformly distributed, no bias is introduced by
+  // keeping them for later calls
+  while (o.vertex_buffer.empty()) {
+    if (calls >= RMGVGeneratorPrimaryPosition::fMaxAttempts) return false;
+    this->FillVertexBuffer(o, collection);
+    calls += fLocalCandidates.size();
+  }
+
+  vertex = o.vertex_buffer.back();
+  o.vertex_buffer.pop_back();
+  return true;
 }
 
 G4ThreeVector RMGGeneratorVolumeConfinement::ShootPrimaryPosition() {
@@ -288,6 +626,9 @@ G4ThreeVector RMGGeneratorVolumeConfinement::ShootPrimaryPosition() {
   this->InitializePhysicalVolumes();
   this->InitializeGeometricalVolumes();
 
+  G4ThreeVector vertex;
+  G4int calls = 0;
+
   switch (fSamplingMode) {
     case SamplingMode::kIntersectPhysicalWithGeometrical : {
       // strategy: sample a point in the geometrical user volume or the
@@ -299,63 +640,142 @@ G4ThreeVector RMGGeneratorVolumeConfinement::ShootPrimaryPosition() {
             "either no physical or no geometrical volumes have been added");
       }
 
-      // choose a volume component randomly
-      SampleableObject choice;
-      G4bool physical_first;
-      if (fOnSurface) {
-        physical_first = fGeomVolumeSolids.total_surface > fPhysicalVolumes.total_surface;
-        choice = physical_first ?
-          fPhysicalVolumes.SurfaceWeightedRand() :
-          fGeomVolumeSolids.SurfaceWeightedRand();
-      }
-      else {
-        physical_first = fGeomVolumeSolids.total_volume > fPhysicalVolumes.total_volume;
-        choice = physical_first ?
-          fPhysicalVolumes.VolumeWeightedRand() :
-          fGeomVolumeSolids.VolumeWeightedRand();
-      }
+      G4bool physical_first = fOnSurface ?
+        fGeomVolumeSolids.total_surface > fPhysicalVolumes.total_surface :
+        fGeomVolumeSolids.total_volume > fPhysicalVolumes.total_volume;
 
-      // shoot in the first region
-      G4ThreeVector vertex;
-      G4int calls = 0;
-      while (calls++ < RMGVGeneratorPrimaryPosition::fMaxAttempts) {
-
-        if (choice.containment_check) { // this can effectively happen only with physical volumes
-          while (fPhysicalVolumes.IsInside(vertex) and calls++ < RMGVGeneratorPrimaryPosition::fMaxAttempts) {
-            vertex = choice.translation + choice.rotation * RMGGeneratorUtil::rand(choice.sampling_solid, fOnSurface);
-          }
-          if (calls >= RMGVGeneratorPrimaryPosition::fMaxAttempts) {
-            RMGLog::Out(RMGLog::error, "Exceeded maximum number of allowed iterations (",
-                RMGVGeneratorPrimaryPosition::fMaxAttempts, "), check that your volumes are efficiently sampleable and ",
-                "try, in case, to increase the threshold through the dedicated macro command. Returning dummy vertex");
-            return RMGVGeneratorPrimaryPosition::kDummyPrimaryPosition;
-          }
-        }
-        else {
-          vertex = choice.translation + choice.rotation * RMGGeneratorUtil::rand(choice.sampling_solid, fOnSurface);
-        }
+      auto& first = physical_first ? fPhysicalVolumes : fGeomVolumeSolids;
+      auto& second = physical_first ? fGeomVolumeSolids : fPhysicalVolumes;
+
+      while (calls < RMGVGeneratorPrimaryPosition::fMaxAttempts) {
+
+        // the volume component must be chosen again at every trial, sticking to
+        // the first choice would bias the distribution across components
+        auto& choice = fOnSurface ? first.SurfaceWeightedRand() : first.VolumeWeightedRand();
+        if (!this->ShootInObject(choice, first, vertex, calls)) break;
 
         // is it also in the other volume class (geometrical/physical)?
-        if (physical_first) { if (fGeomVolumeSolids.IsInside(vertex)) return vertex; }
-        else { if (fPhysicalVolumes.IsInside(vertex)) return vertex; }
+        if (second.IsInside(vertex)) return vertex;
       }
-
-      if (calls >= RMGVGeneratorPrimaryPosition::fMaxAttempts) {
-        RMGLog::Out(RMGLog::error, "Exceeded maximum number of allowed iterations (",
-            RMGVGeneratorPrimaryPosition::fMaxAttempts, "), check that your volumes are efficiently sampleable and ",
-            "try, in case, to increase the threshold through the dedicated macro command. Returning dummy vertex");
+      break;
+    }
+    case SamplingMode::kUnionAll : {
+      // strategy: choose between physical and geometrical volumes according to
+      // their total volume/surface, then pick an object from the chosen
+      // collection and sample in it
+
+      if (fGeomVolumeSolids.empty() and fPhysicalVolumes.empty()) {
+        RMGLog::Out(RMGLog::fatal, "'UnionAll' mode is set but no physical or geometrical ",
+            "volumes have been added");
       }
 
-      return RMGVGeneratorPrimaryPosition::kDummyPrimaryPosition;
+      auto w_physical = fOnSurface ? fPhysicalVolumes.total_surface : fPhysicalVolumes.total_volume;
+      auto w_geometrical = fOnSurface ? fGeomVolumeSolids.total_surface : fGeomVolumeSolids.total_volume;
+
+      auto& collection = (w_physical + w_geometrical) * G4UniformRand() < w_physical ?
+        fPhysicalVolumes : fGeomVolumeSolids;
+      auto& choice = fOnSurface ? collection.SurfaceWeightedRand() : collection.VolumeWeightedRand();
+
+      if (this->ShootInObject(choice, collection, vertex, calls)) return vertex;
       break;
     }
-    case SamplingMode::kUnionAll :
+  }
 
+  RMGLog::Out(RMGLog::error, "Exceeded maximum number of allowed iterations (",
+      RMGVGeneratorPrimaryPosition::fMaxAttempts, "), check that your volumes are efficiently sampleable and ",
+      "try, in case, to increase the threshold through the dedicated macro command. Returning dummy vertex");
 
-      break;
+  return RMGVGeneratorPrimaryPosition::kDummyPrimaryPosition;
+}
+
+void RMGGeneratorVolumeConfinement::PrepareIndependentEvent() {
+
+  RMGVGeneratorPrimaryPosition::PrepareIndependentEvent();
+
+  // accepted vertices are drawn in batches, drop the ones left over
+  for (auto& o : fPhysicalVolumes.data) o.vertex_buffer.clear();
+  for (auto& o : fGeomVolumeSolids.data) o.vertex_buffer.clear();
+}
+
+void RMGGeneratorVolumeConfinement::BeginOfRunAction(const G4Run* run) {
+
+  RMGVGeneratorPrimaryPosition::BeginOfRunAction(run);
+  fRun = RMGRun::GetCurrent();
+}
+
+void RMGGeneratorVolumeConfinement::EndOfRunAction(const G4Run*) {
+
+  fRun = nullptr;
+  for (auto collection : {&fPhysicalVolumes, &fGeomVolumeSolids}) {
+    for (auto& o : collection->data) {
+      o.run_n_trials = nullptr;
+      o.run_n_accepted = nullptr;
+    }
   }
+}
+
+void RMGGeneratorVolumeConfinement::PrintRunSummary(const RMGRun& run) {
 
-  return G4ThreeVector();
+  // counters are named Confinement/<volume|surface>/<object>/<quantity>
+  const G4String prefix = "Confinement/", suffix = "/n_trials";
+  G4bool header = false;
+  for (const auto& c : run.GetCounters()) {
+    const auto& name = c.first;
+    if (name.compare(0, prefix.size(), prefix) != 0 or name.size() <= prefix.size() + suffix.size() or
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+    if (c.second <= 0) continue;
+
+    if (!header) {
+      RMGLog::Out(RMGLog::summary, "Vertex confinement acceptance rate per sampled object:");
+      header = true;
+    }
+    auto object = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    auto n_accepted = run.GetCounterValue(prefix + object + "/n_accepted");
+    RMGLog::OutFormat(RMGLog::summary, " - %-48s %6.2f%% (%.0f/%.0f)", object.c_str(),
+        100. * n_accepted / c.second, n_accepted, c.second);
+  }
+}
+
+void RMGGeneratorVolumeConfinement::WriteVertexFile(G4String file_name, size_t n) {
+
+  if (n == 0) RMGLog::Out(RMGLog::fatal, "Refusing to write an empty vertex file");
+
+  RMGGeneratorVertexFile::VertexFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::strncpy(header.magic, RMGGeneratorVertexFile::kMagic, sizeof(header.magic));
+  header.version = RMGGeneratorVertexFile::kVersion;
+  header.record_size = 3*sizeof(G4double);
+  header.n_vertices = n;
+
+  // write to a temporary file first, such that an aborted job does not leave a
+  // truncated file behind that would be picked up by later runs
+  auto tmp_name = file_name + ".tmp";
+  std::ofstream file(tmp_name, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) RMGLog::Out(RMGLog::fatal, "Could not open '", tmp_name, "' for writing");
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  RMGLog::Out(RMGLog::summary, "Writing ", n, " vertices to file '", file_name, "'");
+
+  const size_t block_size = 4096;
+  std::vector<G4double> block;
+  block.reserve(3*block_size);
+  for (size_t i = 0; i < n; i += block_size) {
+    block.clear();
+    for (size_t j = i; j < std::min(n, i + block_size); ++j) {
+      auto v = this->ShootPrimaryPosition();
+      block.push_back(v.x());
+      block.push_back(v.y());
+      block.push_back(v.z());
+    }
+    file.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(G4double));
+  }
+
+  file.close();
+  if (!file or std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+    std::remove(tmp_name.c_str());
+    RMGLog::Out(RMGLog::fatal, "Could not write vertex file '", file_name, "'");
+  }
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,7 +1,10 @@
 #include "RMGGeneratorVolumeConfinementMessenger.hh"
 
 #include "globals.hh"
+#include <sstream>
+
 #include "G4PhysicalVolumeStore.hh"
+#include "G4Threading.hh"
 
 #include "RMGGeneratorVolumeConfinement.hh"
 #include "RMGTools.hh"
@@ -20,12 +23,17 @@ RMGGeneratorVolumeConfinementMessenger::RMGGeneratorVolumeConfinementMessenger(R
   fDirectories.emplace_back(new G4UIdirectory((directory + "/Geometrical/Cylinder").c_str()));
   fDirectories.emplace_back(new G4UIdirectory((directory + "/Geometrical/CylindricalShell").c_str()));
   fDirectories.emplace_back(new G4UIdirectory((directory + "/Geometrical/Box").c_str()));
+  fDirectories.emplace_back(new G4UIdirectory((directory + "/Grid").c_str()));
 
   fSamplingModeCmd = RMGTools::MakeG4UIcmdWithAString(
-      directory + "/SetSamplingMode", this, "Union IntersectPhysicalWithGeometrical");
+      directory + "/SetSamplingMode", this, "UnionAll IntersectPhysicalWithGeometrical");
 
   fBoundingSolidTypeCmd = RMGTools::MakeG4UIcmdWithAString(
-      directory + "/SetFallbackBoundingVolumeType", this, "Sphere Box");
+      directory + "/SetFallbackBoundingVolumeType", this, "Auto Box Sphere Tube");
+
+  fSampleOnSurfaceCmd = RMGTools::MakeG4UIcmdWithABool(directory + "/SampleOnSurface", this);
+  fSampleOnSurfaceCmd->SetGuidance("Sample on the surface of the volumes instead of in their bulk, "
+      "only for volumes with a natively sampleable solid");
 
   fAddPhysVolCmd = RMGTools::MakeG4UIcmdWithAString(
       directory + "/Physical/AddVolume", this, "");
@@ -71,6 +79,30 @@ RMGGeneratorVolumeConfinementMessenger::RMGGeneratorVolumeConfinementMessenger(R
 
   fNPositionsamplingMaxCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
       directory + "/MaxSamplingTrials", this, "N", "N > 0");
+
+  fVertexPoolSizeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/VertexPoolSize", this, "N", "N >= 0");
+  fVertexPoolSizeCmd->SetGuidance("Number of vertices sampled at once, zero disables the pool. "
+      "Not compatible with per-event seeding");
+
+  // <file name> <number of vertices>
+  fWriteVertexFileCmd = std::unique_ptr<G4UIcommand>(new G4UIcommand((directory + "/WriteVertexFile").c_str(), this));
+  fWriteVertexFileCmd->SetParameter(new G4UIparameter("FileName", 's', false));
+  auto n_par = new G4UIparameter("N", 'l', false);
+  n_par->SetParameterRange("N > 0");
+  fWriteVertexFileCmd->SetParameter(n_par);
+  fWriteVertexFileCmd->SetGuidance("Sample N vertices and write them to a vertex file");
+  fWriteVertexFileCmd->SetGuidance("In multi-threaded mode the file is written by the first worker thread, "
+      "when the commands are passed on to the workers at the beginning of the next run (/run/beamOn with "
+      "at least one event); it is not there before. In sequential mode it is written right away");
+  fWriteVertexFileCmd->AvailableForStates(G4State_Idle);
+
+  // number of cells along the longest side of the volume, zero disables the grid
+  fGridResolutionCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/Grid/Resolution", this, "N", "N >= 0");
+
+  fGridCacheDirectoryCmd = RMGTools::MakeG4UIcmdWithAString(
+      directory + "/Grid/CacheDirectory", this, "");
 }
 
 void RMGGeneratorVolumeConfinementMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
@@ -87,11 +119,14 @@ void RMGGeneratorVolumeConfinementMessenger::SetNewValue(G4UIcommand* cmd, G4Str
   if (cmd == fBoundingSolidTypeCmd.get()) {
     fSampler->SetBoundingSolidType(new_values);
   }
-  if (cmd == fSamplingModeCmd.get()) {
+  else if (cmd == fSamplingModeCmd.get()) {
     if (new_values == "UnionAll") fSampler->SetSamplingMode(RMGGeneratorVolumeConfinement::SamplingMode::kUnionAll);
-    else if (new_values == "IntersectionWithGeometrical") fSampler->SetSamplingMode(RMGGeneratorVolumeConfinement::SamplingMode::kIntersectPhysicalWithGeometrical);
+    else if (new_values == "IntersectPhysicalWithGeometrical") fSampler->SetSamplingMode(RMGGeneratorVolumeConfinement::SamplingMode::kIntersectPhysicalWithGeometrical);
+  }
+  else if (cmd == fSampleOnSurfaceCmd.get()) {
+    fSampler->SetOnSurface(fSampleOnSurfaceCmd->GetNewBoolValue(new_values));
   }
-  if (cmd == fAddPhysVolCmd.get()) {
+  else if (cmd == fAddPhysVolCmd.get()) {
     if (new_values.find(' ') == std::string::npos) fSampler->AddPhysicalVolumeNameRegex(new_values);
     else {
       auto name = new_values.substr(0, new_values.find_first_of(' '));
@@ -99,45 +134,64 @@ void RMGGeneratorVolumeConfinementMessenger::SetNewValue(G4UIcommand* cmd, G4Str
       fSampler->AddPhysicalVolumeNameRegex(name, copy_nr);
     }
   }
-  if (cmd == fAddGeomVolCmd.get()) {
+  else if (cmd == fAddGeomVolCmd.get()) {
     fSampler->GetGeometricalSolidDataList().emplace_back();
+    fSampler->GetGeometricalSolidDataList().back().g4_name = new_values;
   }
-  if (cmd == fSphereInnerRadiusVolCmd.get()) {
+  else if (cmd == fSphereInnerRadiusVolCmd.get()) {
     get_last_geom_solid().sphere_inner_radius = fSphereInnerRadiusVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fSphereOuterRadiusVolCmd.get()) {
-    get_last_geom_solid().sphere_inner_radius = fSphereOuterRadiusVolCmd->GetNewDoubleValue(new_values);
+  else if (cmd == fSphereOuterRadiusVolCmd.get()) {
+    get_last_geom_solid().sphere_outer_radius = fSphereOuterRadiusVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fCylinderInnerRadiusVolCmd.get()) {
+  else if (cmd == fCylinderInnerRadiusVolCmd.get()) {
     get_last_geom_solid().cylinder_inner_radius = fCylinderInnerRadiusVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fCylinderOuterRadiusVolCmd.get()) {
+  else if (cmd == fCylinderOuterRadiusVolCmd.get()) {
     get_last_geom_solid().cylinder_outer_radius = fCylinderOuterRadiusVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fCylinderHeightVolCmd.get()) {
+  else if (cmd == fCylinderHeightVolCmd.get()) {
     get_last_geom_solid().cylinder_height = fCylinderHeightVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fCylinderStartingAngleVolCmd.get()) {
+  else if (cmd == fCylinderStartingAngleVolCmd.get()) {
     get_last_geom_solid().cylinder_starting_angle = fCylinderStartingAngleVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fCylinderSpanningAngleVolCmd.get()) {
+  else if (cmd == fCylinderSpanningAngleVolCmd.get()) {
     get_last_geom_solid().cylinder_spanning_angle = fCylinderSpanningAngleVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fBoxXLengthVolCmd.get()) {
+  else if (cmd == fBoxXLengthVolCmd.get()) {
     get_last_geom_solid().box_x_length = fBoxXLengthVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fBoxYLengthVolCmd.get()) {
+  else if (cmd == fBoxYLengthVolCmd.get()) {
     get_last_geom_solid().box_y_length = fBoxYLengthVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fBoxZLengthVolCmd.get()) {
+  else if (cmd == fBoxZLengthVolCmd.get()) {
     get_last_geom_solid().box_z_length = fBoxZLengthVolCmd->GetNewDoubleValue(new_values);
   }
-  if (cmd == fGeomVolCenterCmd.get()) {
+  else if (cmd == fGeomVolCenterCmd.get()) {
     get_last_geom_solid().volume_center = fGeomVolCenterCmd->GetNew3VectorValue(new_values);
   }
-  if (cmd == fNPositionsamplingMaxCmd.get()) {
+  else if (cmd == fNPositionsamplingMaxCmd.get()) {
     fSampler->SetMaxAttempts(fNPositionsamplingMaxCmd->GetNewIntValue(new_values));
   }
+  else if (cmd == fVertexPoolSizeCmd.get()) {
+    fSampler->SetVertexPoolSize(fVertexPoolSizeCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fGridResolutionCmd.get()) {
+    fSampler->SetGridResolution(fGridResolutionCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fGridCacheDirectoryCmd.get()) {
+    fSampler->SetGridCacheDirectory(new_values);
+  }
+  else if (cmd == fWriteVertexFileCmd.get()) {
+    std::istringstream iss(new_values);
+    G4String file_name; size_t n = 0;
+    iss >> file_name >> n;
+    // all threads share the same messenger commands, let only one of them
+    // write. The master has no generator, in multi-threaded mode worker 0
+    // writes at the beginning of the next run (see the guidance)
+    if (G4Threading::G4GetThreadId() <= 0) fSampler->WriteVertexFile(file_name, n);
+  }
   else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), "not known");
 }
 
@@ -0,0 +1,113 @@
+#include "RMGPrimaryBatch.hh"
+
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4ParticleDefinition.hh"
+
+#include "RMGEventInformation.hh"
+#include "RMGLog.hh"
+
+void RMGPrimaryBatch::Reserve(size_t n_events, size_t n_primaries_per_event) {
+
+  vertex_x.reserve(n_events);
+  vertex_y.reserve(n_events);
+  vertex_z.reserve(n_events);
+  vertex_t.reserve(n_events);
+  weight.reserve(n_events);
+  first_primary.reserve(n_events + 1);
+
+  auto n = n_events * n_primaries_per_event;
+  particle.reserve(n);
+  px.reserve(n);
+  py.reserve(n);
+  pz.reserve(n);
+  charge.reserve(n);
+  pol_x.reserve(n);
+  pol_y.reserve(n);
+  pol_z.reserve(n);
+  time.reserve(n);
+}
+
+void RMGPrimaryBatch::Clear() {
+
+  // keeps the capacity, the batch is refilled over and over
+  vertex_x.clear();
+  vertex_y.clear();
+  vertex_z.clear();
+  vertex_t.clear();
+  weight.clear();
+  first_primary.assign(1, 0);
+
+  particle.clear();
+  px.clear();
+  py.clear();
+  pz.clear();
+  charge.clear();
+  pol_x.clear();
+  pol_y.clear();
+  pol_z.clear();
+  time.clear();
+}
+
+void RMGPrimaryBatch::AddVertex(const G4ThreeVector& position, G4double time, G4double w) {
+
+  vertex_x.push_back(position.x());
+  vertex_y.push_back(position.y());
+  vertex_z.push_back(position.z());
+  vertex_t.push_back(time);
+  weight.push_back(w);
+}
+
+void RMGPrimaryBatch::AddPrimary(const G4ParticleDefinition* p, const G4ThreeVector& momentum,
+    G4double q, const G4ThreeVector& polarization, G4double t) {
+
+  if (this->GetNumberOfClosedEvents() >= this->GetNumberOfEvents()) {
+    RMGLog::Out(RMGLog::fatal, "Primary particle added to a batch with no open event left");
+  }
+
+  particle.push_back(p);
+  px.push_back(momentum.x());
+  py.push_back(momentum.y());
+  pz.push_back(momentum.z());
+  charge.push_back(q);
+  pol_x.push_back(polarization.x());
+  pol_y.push_back(polarization.y());
+  pol_z.push_back(polarization.z());
+  time.push_back(t);
+}
+
+void RMGPrimaryBatch::CloseEvent() {
+
+  if (this->GetNumberOfClosedEvents() >= this->GetNumberOfEvents()) {
+    RMGLog::Out(RMGLog::fatal, "Closing an event beyond the number of vertices in the batch");
+  }
+  first_primary.push_back(particle.size());
+}
+
+void RMGPrimaryBatch::FillEvent(size_t i, G4Event* event) const {
+
+  if (i >= this->GetNumberOfClosedEvents()) {
+    RMGLog::Out(RMGLog::fatal, "Event ", i, " requested from a batch of ",
+        this->GetNumberOfClosedEvents(), " complete events");
+  }
+
+  G4PrimaryVertex* vertex = nullptr;
+  for (auto j = first_primary[i]; j < first_primary[i+1]; ++j) {
+    if (!vertex or time[j] != time[j-1]) {
+      vertex = new G4PrimaryVertex(vertex_x[i], vertex_y[i], vertex_z[i], vertex_t[i] + time[j]);
+      event->AddPrimaryVertex(vertex);
+    }
+    auto p = new G4PrimaryParticle(particle[j], px[j], py[j], pz[j]);
+    p->SetCharge(charge[j]);
+    p->SetPolarization(pol_x[j], pol_y[j], pol_z[j]);
+    vertex->SetPrimary(p);
+  }
+
+  // keep the event vertex even if there are no primaries
+  if (!vertex) event->AddPrimaryVertex(new G4PrimaryVertex(vertex_x[i], vertex_y[i], vertex_z[i], vertex_t[i]));
+
+  RMGEventInformation::GetOrCreate(event)->SetWeight(weight[i]);
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,30 @@
+#include "RMGReplayCursor.hh"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#include "Randomize.hh"
+
+namespace {
+  std::mutex gCursorsMutex;
+  std::map<G4String, std::weak_ptr<RMGReplayCursor>> gCursors;
+}
+
+std::shared_ptr<RMGReplayCursor> RMGReplayCursor::Get(const G4String& file_name, std::uint64_t n_entries) {
+
+  std::lock_guard<std::mutex> lock(gCursorsMutex);
+
+  auto cursor = gCursors[file_name].lock();
+  if (!cursor or cursor->GetNEntries() != n_entries) {
+    cursor = std::shared_ptr<RMGReplayCursor>(new RMGReplayCursor(n_entries));
+    gCursors[file_name] = cursor;
+  }
+  return cursor;
+}
+
+void RMGReplayCursor::DrawStart() {
+  fStart = std::min<std::uint64_t>(G4UniformRand() * fNEntries, fNEntries - 1);
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
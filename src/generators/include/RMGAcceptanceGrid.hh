@@ -0,0 +1,99 @@
+#ifndef _RMG_ACCEPTANCE_GRID_HH_
+#define _RMG_ACCEPTANCE_GRID_HH_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+/**
+ * Regular grid of cells over the bounding box of a solid, each of them
+ * classified as fully inside, fully outside or crossed by the boundary of
+ * the volume. Vertices are drawn uniformly in the union of the inside and
+ * boundary cells (all cells have the same volume), only those falling in a
+ * boundary cell still need a containment check.
+ *
+ * The classification is the expensive part, it can be cached on disk: the
+ * cache file is keyed by a hash of the geometry description provided by the
+ * caller.
+ *
+ * Grids are immutable once built. Worker threads confining vertices in the
+ * same volume share a single instance through BuildShared(), such that the
+ * memory footprint does not grow with the number of threads.
+ */
+class RMGAcceptanceGrid {
+
+  public:
+
+    enum CellType : std::uint8_t {
+      kOutsideCell = 0,
+      kInsideCell,
+      kBoundaryCell
+    };
+
+    /// Classify the cell centred in `center` with half diagonal `half_diagonal`
+    using Classifier = std::function<CellType(const G4ThreeVector& center, G4double half_diagonal)>;
+
+    RMGAcceptanceGrid() = default;
+    ~RMGAcceptanceGrid() = default;
+
+    RMGAcceptanceGrid           (RMGAcceptanceGrid const&) = delete;
+    RMGAcceptanceGrid& operator=(RMGAcceptanceGrid const&) = delete;
+    RMGAcceptanceGrid           (RMGAcceptanceGrid&&)      = delete;
+    RMGAcceptanceGrid& operator=(RMGAcceptanceGrid&&)      = delete;
+
+    /// Build the grid over [pmin, pmax] with `resolution` cells along the
+    /// longest side. If `cache_dir` is not empty the classification is read
+    /// from (or written to) a file named after `key`
+    void Build(const G4ThreeVector& pmin, const G4ThreeVector& pmax, G4int resolution,
+        const Classifier& classifier, std::uint64_t key = 0, G4String cache_dir = "");
+
+    /// Same as Build(), but grids with the same key, box and resolution are
+    /// built only once per process and shared between threads
+    static std::shared_ptr<const RMGAcceptanceGrid> BuildShared(const G4ThreeVector& pmin,
+        const G4ThreeVector& pmax, G4int resolution, const Classifier& classifier,
+        std::uint64_t key = 0, G4String cache_dir = "");
+
+    /// Draw a point uniformly in the non-empty cells. `needs_check` is set if
+    /// the point lies in a boundary cell
+    G4ThreeVector Sample(G4bool& needs_check) const;
+
+    inline G4bool empty() const { return fCells.empty(); }
+    inline size_t GetNInsideCells() const { return fNInside; }
+    inline size_t GetNBoundaryCells() const { return fCells.size() - fNInside; }
+    inline G4double GetSampledVolume() const {
+      return fCells.size() * fCellSize.x() * fCellSize.y() * fCellSize.z();
+    }
+
+    /// FNV-1a, stable across platforms and builds (unlike std::hash)
+    static std::uint64_t Hash(const std::string& data, std::uint64_t seed = 14695981039346656037ULL);
+
+  private:
+
+    G4bool ReadCache(const G4String& file_name, std::uint64_t key, std::vector<std::uint8_t>& types) const;
+    void WriteCache(const G4String& file_name, std::uint64_t key, const std::vector<std::uint8_t>& types) const;
+
+    G4ThreeVector              fMin;
+    G4ThreeVector              fCellSize;
+    G4int                      fN[3] = {0, 0, 0};
+    std::vector<std::uint32_t> fCells;   // non-empty cells, inside ones first
+    size_t                     fNInside = 0;
+
+    // one lock per grid: threads building different grids do not wait for
+    // each other, the map lock is only held for the lookup
+    struct SharedGrid {
+      std::mutex                               mutex;
+      std::shared_ptr<const RMGAcceptanceGrid> grid;
+    };
+    static std::mutex fSharedGridsMutex;
+    static std::map<std::uint64_t, std::shared_ptr<SharedGrid>> fSharedGrids;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
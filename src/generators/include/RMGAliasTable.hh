@@ -0,0 +1,41 @@
+#ifndef _RMG_ALIAS_TABLE_HH_
+#define _RMG_ALIAS_TABLE_HH_
+
+#include <vector>
+
+#include "globals.hh"
+
+/**
+ * Walker's alias table for sampling an index from a discrete distribution
+ * in constant time. The table is built once from the (unnormalized) weights,
+ * each draw then costs a single uniform random number and one comparison.
+ */
+class RMGAliasTable {
+
+  public:
+
+    RMGAliasTable() = default;
+    ~RMGAliasTable() = default;
+
+    void Build(const std::vector<G4double>& weights);
+
+    /// Draw an index, consumes one random number from the thread engine
+    size_t Sample() const;
+    /// Draw an index from a user supplied uniform number in [0, 1)
+    size_t Sample(G4double u) const;
+
+    inline G4bool empty() const { return fProbabilities.empty(); }
+    inline size_t size() const { return fProbabilities.size(); }
+    inline G4double GetTotalWeight() const { return fTotalWeight; }
+    inline void clear() { fProbabilities.clear(); fAliases.clear(); fTotalWeight = 0; }
+
+  private:
+
+    std::vector<G4double> fProbabilities;
+    std::vector<size_t>   fAliases;
+    G4double              fTotalWeight = 0;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -9,28 +9,106 @@
 #include "G4ThreeVector.hh"
 
 #if RMG_HAS_BXDECAY0
-#include "bxdecay0_g4/primary_generator_action.hh"
+#include "bxdecay0/i_random.h"
+#include "bxdecay0/event.h"
 #endif
 
 class G4Event;
+class G4Run;
+class RMGRun;
+class RMGPrimaryBatch;
+
+/**
+ * Radioactive and double beta decays from BxDecay0. The bxdecay0 generator,
+ * with its spectrum tables, is initialized once per configuration and shared
+ * by all threads. bxdecay0 does not promise that shooting leaves the
+ * generator untouched, it is used under a lock. Random numbers are drawn
+ * from the thread-local Geant4 engine such that worker threads produce
+ * independent, reproducible event sequences.
+ *
+ * For double beta decays the summed electron energy can be restricted to a
+ * window. Each event then represents only the fraction of the decays that
+ * fall into the window, which is returned by GetEventWeight(). The number of
+ * events generated in the window is summed over the threads and reported by
+ * the master at the end of the run
+ */
 class RMGGeneratorDecay0 : public RMGVGenerator {
 
   public:
 
+    enum DecayCategory {
+      kBackground,
+      kDoubleBeta
+    };
+
     RMGGeneratorDecay0();
-    inline ~RMGGeneratorDecay0() = default;
+    ~RMGGeneratorDecay0();
 
     RMGGeneratorDecay0           (RMGGeneratorDecay0 const&) = delete;
     RMGGeneratorDecay0& operator=(RMGGeneratorDecay0 const&) = delete;
     RMGGeneratorDecay0           (RMGGeneratorDecay0&&)      = delete;
     RMGGeneratorDecay0& operator=(RMGGeneratorDecay0&&)      = delete;
 
+    void BeginOfRunAction(const G4Run*) override;
+    void EndOfRunAction(const G4Run*) override;
     void GeneratePrimaryVertex(G4Event*) override;
-    inline void SetParticlePosition(G4ThreeVector) override {};
+    inline void SetParticlePosition(G4ThreeVector vec) override { fParticlePosition = vec; }
+
+    inline G4bool IsBatchCapable() const override { return true; }
+    void GeneratePrimaryBatch(RMGPrimaryBatch& batch) override;
+
+    // to be used in the messenger class, changes take effect at the next event
+    inline void SetDecayCategory(DecayCategory cat) { fDecayCategory = cat; this->Reset(); }
+    inline void SetNuclide(G4String nuclide) { fNuclide = nuclide; this->Reset(); }
+    inline void SetDoubleBetaMode(G4int mode) { fDoubleBetaMode = mode; this->Reset(); }
+    inline void SetDoubleBetaLevel(G4int level) { fDoubleBetaLevel = level; this->Reset(); }
+    inline void SetEnergyWindowMin(G4double e) { fEnergyWindowMin = e; this->Reset(); }
+    inline void SetEnergyWindowMax(G4double e) { fEnergyWindowMax = e; this->Reset(); }
+
+    /// Fraction of the decays represented by each generated event, one unless
+    /// an energy window is used
+    inline G4double GetEventWeight() const override { return fEventWeight; }
+    /// The bxdecay0 initialization might use random numbers, it is done before
+    /// the event is seeded
+    inline void PrepareIndependentEvent() override { if (!fSharedGenerator) this->Initialize(); }
 
   private:
 
-    std::unique_ptr<bxdecay0_g4::PrimaryGeneratorAction> fDecay0G4Generator;
+    // bxdecay0 generator shared by the threads with the same configuration
+    struct SharedGenerator;
+
+    static void PrintRunSummary(const RMGRun& run);
+
+    void Initialize();
+    void Reset();
+    G4bool HasEnergyWindow() const;
+
+    DecayCategory fDecayCategory;
+    G4String      fNuclide;
+    G4int         fDoubleBetaMode;
+    G4int         fDoubleBetaLevel;
+    // on the summed electron energy, negative means unset. A window needs
+    // the upper bound, the lower one defaults to zero
+    G4double      fEnergyWindowMin;
+    G4double      fEnergyWindowMax;
+
+    G4ThreeVector fParticlePosition;
+    G4double      fEventWeight;
+    // counters of the current run, for energy windows only
+    G4double*     fRunNGenerated;
+    G4double*     fRunSumOfWeights;
+
+    // bxdecay0 random interface on top of the thread-local Geant4 engine
+    struct Random : public bxdecay0::i_random {
+      double operator()() override;
+    };
+
+    // shoots one decay and stores it in fDecay
+    void ShootDecay();
+
+    Random                           fRandom;
+    bxdecay0::event                  fDecay;
+    std::shared_ptr<SharedGenerator> fSharedGenerator;
 };
 
 #endif
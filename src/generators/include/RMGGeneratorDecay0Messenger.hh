@@ -0,0 +1,44 @@
+#ifndef _RMG_GENERATOR_DECAY0_MESSENGER_HH_
+#define _RMG_GENERATOR_DECAY0_MESSENGER_HH_
+
+#include <memory>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+
+class G4UIcommand;
+class RMGGeneratorDecay0;
+class RMGGeneratorDecay0Messenger : public G4UImessenger {
+
+  public:
+
+    RMGGeneratorDecay0Messenger(RMGGeneratorDecay0* generator);
+    ~RMGGeneratorDecay0Messenger() = default;
+
+    RMGGeneratorDecay0Messenger           (RMGGeneratorDecay0Messenger const&) = delete;
+    RMGGeneratorDecay0Messenger& operator=(RMGGeneratorDecay0Messenger const&) = delete;
+    RMGGeneratorDecay0Messenger           (RMGGeneratorDecay0Messenger&&)      = delete;
+    RMGGeneratorDecay0Messenger& operator=(RMGGeneratorDecay0Messenger&&)      = delete;
+
+    void SetNewValue(G4UIcommand* command, G4String new_values) override;
+
+  private:
+
+    RMGGeneratorDecay0* fGenerator;
+
+    std::unique_ptr<G4UIdirectory>             fDirectory;
+    std::unique_ptr<G4UIcmdWithAString>        fCategoryCmd;
+    std::unique_ptr<G4UIcmdWithAString>        fNuclideCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger>      fDoubleBetaModeCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger>      fDoubleBetaLevelCmd;
+    std::unique_ptr<G4UIcmdWithADoubleAndUnit> fEnergyWindowMinCmd;
+    std::unique_ptr<G4UIcmdWithADoubleAndUnit> fEnergyWindowMaxCmd;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,104 @@
+#ifndef _RMG_GENERATOR_EVENT_LIBRARY_HH_
+#define _RMG_GENERATOR_EVENT_LIBRARY_HH_
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include "RMGVGenerator.hh"
+#include "RMGMappedFile.hh"
+#include "RMGReplayCursor.hh"
+
+class G4Event;
+class G4ParticleDefinition;
+class RMGPrimaryBatch;
+
+/**
+ * Replays pre-generated primary kinematics from a binary event library, as
+ * written by RMGGeneratorPrimary::WriteEventLibrary(). The library is
+ * memory-mapped and events are read in place, starting from a random event
+ * and wrapping around at the end of the file, with a cursor shared by all the
+ * threads replaying the same library. The vertex position comes from
+ * the primary position generator, as for all the other generators.
+ *
+ * File layout (native endianness):
+ *  - an EventLibraryHeader
+ *  - n_tracks TrackRecord, grouped by event
+ *  - n_events + 1 offsets (uint64) of the first track of each event, the last
+ *    one equal to n_tracks
+ *  - n_events statistical weights (double), since version 2
+ */
+class RMGGeneratorEventLibrary : public RMGVGenerator {
+
+  public:
+
+    struct EventLibraryHeader {
+      char          magic[8];    // "RMGEVL\0\0"
+      std::uint32_t version;
+      std::uint32_t record_size; // bytes per track
+      std::uint64_t n_events;
+      std::uint64_t n_tracks;
+    };
+
+    struct TrackRecord {
+      std::int32_t pdg_code;
+      float        px, py, pz;   // MeV
+      double       time;         // ns, relative to the event vertex
+    };
+
+    static constexpr const char* kMagic = "RMGEVL";
+    static constexpr std::uint32_t kVersion = 2;
+
+    /// Composite generators owning several instances create them without
+    /// messenger, UI commands must be unique
+    RMGGeneratorEventLibrary(G4bool with_messenger=true);
+    ~RMGGeneratorEventLibrary() = default;
+
+    RMGGeneratorEventLibrary           (RMGGeneratorEventLibrary const&) = delete;
+    RMGGeneratorEventLibrary& operator=(RMGGeneratorEventLibrary const&) = delete;
+    RMGGeneratorEventLibrary           (RMGGeneratorEventLibrary&&)      = delete;
+    RMGGeneratorEventLibrary& operator=(RMGGeneratorEventLibrary&&)      = delete;
+
+    void GeneratePrimaryVertex(G4Event* event) override;
+    inline void SetParticlePosition(G4ThreeVector vec) override { fParticlePosition = vec; }
+
+    inline G4bool IsBatchCapable() const override { return true; }
+    void GeneratePrimaryBatch(RMGPrimaryBatch& batch) override;
+    inline G4double GetEventWeight() const override { return fEventWeight; }
+    /// The next event is drawn at random with the event random engine, instead
+    /// of following the previous one in the library shared by all threads
+    inline void PrepareIndependentEvent() override { fIndependentEvents = true; fRandomizeCursor = true; }
+
+    inline void SetFileName(G4String name) { fFileName = name; fFile.Close(); fReplayCursor.reset(); }
+    inline const G4String& GetFileName() const { return fFileName; }
+
+  private:
+
+    void OpenFile();
+    // index of the next event to be replayed
+    std::uint64_t NextEvent();
+    const G4ParticleDefinition* GetParticleDefinition(std::int32_t pdg_code);
+
+    G4String             fFileName;
+    RMGMappedFile        fFile;
+    const TrackRecord*   fTracks;
+    const std::uint64_t* fOffsets;
+    const G4double*      fWeights; // null for unweighted libraries
+    G4double             fEventWeight;
+    std::uint64_t        fNEvents;
+    std::shared_ptr<RMGReplayCursor> fReplayCursor;
+    // private cursor, for independent events only
+    std::uint64_t        fCursor;
+    G4bool               fIndependentEvents;
+    G4bool               fRandomizeCursor;
+    G4ThreeVector        fParticlePosition;
+
+    std::unordered_map<std::int32_t, const G4ParticleDefinition*> fParticleCache;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,37 @@
+#ifndef _RMG_GENERATOR_EVENT_LIBRARY_MESSENGER_HH_
+#define _RMG_GENERATOR_EVENT_LIBRARY_MESSENGER_HH_
+
+#include <memory>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+
+class G4UIcommand;
+class RMGGeneratorEventLibrary;
+class RMGGeneratorEventLibraryMessenger : public G4UImessenger {
+
+  public:
+
+    RMGGeneratorEventLibraryMessenger(RMGGeneratorEventLibrary* generator);
+    ~RMGGeneratorEventLibraryMessenger() = default;
+
+    RMGGeneratorEventLibraryMessenger           (RMGGeneratorEventLibraryMessenger const&) = delete;
+    RMGGeneratorEventLibraryMessenger& operator=(RMGGeneratorEventLibraryMessenger const&) = delete;
+    RMGGeneratorEventLibraryMessenger           (RMGGeneratorEventLibraryMessenger&&)      = delete;
+    RMGGeneratorEventLibraryMessenger& operator=(RMGGeneratorEventLibraryMessenger&&)      = delete;
+
+    void SetNewValue(G4UIcommand* command, G4String new_values) override;
+
+  private:
+
+    RMGGeneratorEventLibrary* fGenerator;
+
+    std::unique_ptr<G4UIdirectory>      fDirectory;
+    std::unique_ptr<G4UIcmdWithAString> fFileNameCmd;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -2,11 +2,15 @@
 #define _RMGGENERATORG4GUN_HH_
 
 #include <memory>
+#include <cmath>
 
 #include "RMGVGenerator.hh"
+#include "RMGPrimaryBatch.hh"
+#include "RMGLog.hh"
 
 #include "G4ThreeVector.hh"
 #include "G4ParticleGun.hh"
+#include "G4ParticleDefinition.hh"
 
 class G4Event;
 class G4ParticleGun;
@@ -32,6 +36,28 @@ class RMGGeneratorG4Gun : public RMGVGenerator {
       fParticleGun->SetParticlePosition(vec);
     }
 
+    inline G4bool IsBatchCapable() const override { return true; }
+
+    // the gun settings are the same for all events of the batch, hence the
+    // kinematics is computed once and only copied over
+    inline void GeneratePrimaryBatch(RMGPrimaryBatch& batch) override {
+      auto particle = fParticleGun->GetParticleDefinition();
+      if (!particle) RMGLog::Out(RMGLog::fatal, "Particle gun has no particle definition");
+
+      auto ekin = fParticleGun->GetParticleEnergy();
+      auto mass = particle->GetPDGMass();
+      auto momentum = fParticleGun->GetParticleMomentumDirection() * std::sqrt(ekin * (ekin + 2*mass));
+      auto charge = fParticleGun->GetParticleCharge();
+      auto polarization = fParticleGun->GetParticlePolarization();
+      auto n_particles = fParticleGun->GetNumberOfParticlesToBeGenerated();
+
+      for (size_t i = 0; i < batch.GetNumberOfEvents(); ++i) {
+        batch.vertex_t[i] = fParticleGun->GetParticleTime();
+        for (G4int j = 0; j < n_particles; ++j) batch.AddPrimary(particle, momentum, charge, polarization);
+        batch.CloseEvent();
+      }
+    }
+
   private:
 
     std::unique_ptr<G4ParticleGun> fParticleGun;
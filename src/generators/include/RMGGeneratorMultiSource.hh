@@ -0,0 +1,85 @@
+#ifndef _RMG_GENERATOR_MULTI_SOURCE_HH_
+#define _RMG_GENERATOR_MULTI_SOURCE_HH_
+
+#include <memory>
+#include <vector>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include "RMGVGenerator.hh"
+#include "RMGAliasTable.hh"
+#include "RMGGeneratorVolumeConfinement.hh"
+#include "RMGGeneratorEventLibrary.hh"
+
+class G4Event;
+class G4Run;
+class RMGRun;
+
+/**
+ * Simulates a whole background model in a single job. Each source is a set
+ * of physical volumes, selected by a name pattern, emitting the events of an
+ * event library with a given total activity. For every event a source is
+ * drawn with probability proportional to its activity, the vertex is sampled
+ * in its volumes and the event is tagged with the source index in the
+ * RMGEventInformation.
+ *
+ * Sources place their own vertices, the primary position generator is not
+ * used. The confinement options (sampling mode, fallback bounding volume,
+ * surface sampling) are set per source, right after adding it.
+ *
+ * The number of events per source is summed over the threads, the master
+ * reports it with the corresponding live time at the end of the run.
+ */
+class RMGGeneratorMultiSource : public RMGVGenerator {
+
+  public:
+
+    RMGGeneratorMultiSource();
+    ~RMGGeneratorMultiSource() = default;
+
+    RMGGeneratorMultiSource           (RMGGeneratorMultiSource const&) = delete;
+    RMGGeneratorMultiSource& operator=(RMGGeneratorMultiSource const&) = delete;
+    RMGGeneratorMultiSource           (RMGGeneratorMultiSource&&)      = delete;
+    RMGGeneratorMultiSource& operator=(RMGGeneratorMultiSource&&)      = delete;
+
+    void BeginOfRunAction(const G4Run*) override;
+    void EndOfRunAction(const G4Run*) override;
+    void GeneratePrimaryVertex(G4Event* event) override;
+    inline void SetParticlePosition(G4ThreeVector) override {};
+    inline G4bool PlacesOwnVertices() const override { return true; }
+    void PrepareIndependentEvent() override;
+    G4double GetEventWeight() const override;
+
+    /// Activity in Bq, of the source as a whole
+    void AddSource(G4String volume_regex, G4String library, G4double activity);
+    inline size_t GetNumberOfSources() const { return fSources.size(); }
+    /// Confinement of the last added source, to set its options
+    RMGGeneratorVolumeConfinement* GetLastSourceConfinement();
+
+  private:
+
+    // what the master needs to report on the sources
+    struct SourceInfo {
+      G4String volume_regex;
+      G4String library;
+      G4double activity;
+    };
+
+    struct Source {
+      SourceInfo info;
+      std::unique_ptr<RMGGeneratorVolumeConfinement> confinement;
+      std::unique_ptr<RMGGeneratorEventLibrary>      generator;
+      G4double* run_n_events; // counter of the current run
+    };
+
+    static void PrintRunSummary(const std::vector<SourceInfo>& sources, const RMGRun& run);
+
+    std::vector<Source> fSources;
+    RMGAliasTable       fSourceTable;
+    G4int               fLastSource;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,42 @@
+#ifndef _RMG_GENERATOR_MULTI_SOURCE_MESSENGER_HH_
+#define _RMG_GENERATOR_MULTI_SOURCE_MESSENGER_HH_
+
+#include <memory>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+
+class RMGGeneratorMultiSource;
+class RMGGeneratorMultiSourceMessenger : public G4UImessenger {
+
+  public:
+
+    RMGGeneratorMultiSourceMessenger(RMGGeneratorMultiSource* generator);
+    ~RMGGeneratorMultiSourceMessenger() = default;
+
+    RMGGeneratorMultiSourceMessenger           (RMGGeneratorMultiSourceMessenger const&) = delete;
+    RMGGeneratorMultiSourceMessenger& operator=(RMGGeneratorMultiSourceMessenger const&) = delete;
+    RMGGeneratorMultiSourceMessenger           (RMGGeneratorMultiSourceMessenger&&)      = delete;
+    RMGGeneratorMultiSourceMessenger& operator=(RMGGeneratorMultiSourceMessenger&&)      = delete;
+
+    void SetNewValue(G4UIcommand* command, G4String new_values) override;
+
+  private:
+
+    RMGGeneratorMultiSource* fGenerator;
+
+    std::unique_ptr<G4UIdirectory> fDirectory;
+    std::unique_ptr<G4UIcommand>   fAddSourceCmd;
+    // confinement options of the last added source
+    std::unique_ptr<G4UIcmdWithAString> fSamplingModeCmd;
+    std::unique_ptr<G4UIcmdWithAString> fBoundingSolidTypeCmd;
+    std::unique_ptr<G4UIcmdWithABool>   fSampleOnSurfaceCmd;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -8,6 +8,7 @@
 
 #include "RMGVGeneratorPrimaryPosition.hh"
 #include "RMGVGenerator.hh"
+#include "RMGPrimaryBatch.hh"
 #include "RMGGeneratorPrimaryMessenger.hh"
 
 class RMGGeneratorPrimary : public G4VUserPrimaryGeneratorAction {
@@ -16,7 +17,8 @@ class RMGGeneratorPrimary : public G4VUserPrimaryGeneratorAction {
 
     enum ConfinementCode {
       kUnConfined,
-      kVolume
+      kVolume,
+      kFromFile
     };
 
     RMGGeneratorPrimary();
@@ -29,15 +31,35 @@ class RMGGeneratorPrimary : public G4VUserPrimaryGeneratorAction {
 
     void GeneratePrimaries(G4Event *event) override;
 
+    /// Generate n events with the current generator and store their primaries
+    /// in a binary event library, to be replayed later by RMGGeneratorEventLibrary
+    void WriteEventLibrary(G4String file_name, size_t n);
+
     inline RMGVGenerator* GetRMGGenerator() { return fRMGGenerator.get(); }
+    inline RMGVGeneratorPrimaryPosition* GetPrimaryPositionGenerator() { return fPrimaryPositionGenerator.get(); }
     inline ConfinementCode GetConfinementCode() const { return fConfinementCode; }
 
     void SetConfinementCode(ConfinementCode code);
-    inline void SetGenerator(RMGVGenerator* gen) { fRMGGenerator = std::unique_ptr<RMGVGenerator>(gen); }
+    inline void SetGenerator(RMGVGenerator* gen) {
+      fRMGGenerator = std::unique_ptr<RMGVGenerator>(gen);
+      this->ClearPrimaryBatch();
+    }
+
+    /// Number of events whose primaries are generated at once by batch capable
+    /// generators, zero (default) or one disables batching
+    inline void SetBatchSize(size_t n) { fBatchSize = n; this->ClearPrimaryBatch(); }
+    inline size_t GetBatchSize() const { return fBatchSize; }
+    // to be called at the beginning of each run, events are never carried over
+    inline void ClearPrimaryBatch() { fPrimaryBatch.Clear(); fPrimaryBatchCursor = 0; }
 
   private:
 
+    void FillPrimaryBatch();
+
     ConfinementCode fConfinementCode;
+    size_t          fBatchSize;
+    RMGPrimaryBatch fPrimaryBatch;
+    size_t          fPrimaryBatchCursor;
     std::unique_ptr<RMGVGeneratorPrimaryPosition>  fPrimaryPositionGenerator;
     std::unique_ptr<RMGVGenerator>                 fRMGGenerator;
     std::unique_ptr<RMGGeneratorPrimaryMessenger>  fG4Messenger;
@@ -7,6 +7,8 @@
 #include "G4UImessenger.hh"
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcommand.hh"
 
 class G4UIcommand;
 class RMGGeneratorPrimary;
@@ -32,6 +34,8 @@ class RMGGeneratorPrimaryMessenger : public G4UImessenger {
 
     std::unique_ptr<G4UIcmdWithAString>      fSelectCmd;
     std::unique_ptr<G4UIcmdWithAString>      fConfineCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger>    fBatchSizeCmd;
+    std::unique_ptr<G4UIcommand>             fWriteEventLibraryCmd;
 };
 
 #endif
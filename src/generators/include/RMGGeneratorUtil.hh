@@ -1,19 +1,75 @@
 #ifndef _RMGGENERATORUTIL_HH
 #define _RMGGENERATORUTIL_HH
 
+#include <array>
+#include <functional>
+#include <vector>
+
 #include "globals.hh"
 #include "G4ThreeVector.hh"
+#include "G4TwoVector.hh"
 #include "G4VSolid.hh"
 #include "G4Box.hh"
 #include "G4Orb.hh"
 #include "G4Sphere.hh"
 #include "G4Tubs.hh"
+#include "G4Cons.hh"
+#include "G4Trd.hh"
+#include "G4Polycone.hh"
+#include "G4GenericPolycone.hh"
+#include "G4Polyhedra.hh"
 #include "G4VPhysicalVolume.hh"
 
+#include "RMGAliasTable.hh"
+
 namespace RMGGeneratorUtil {
 
   G4bool IsSampleable(G4String g4_solid_type);
 
+  /// Natively sampleable shape enclosing a solid, described by its
+  /// dimensions only: no G4VSolid is created for it
+  struct BoundingSolid {
+    G4String      type;   // "Box", "Sphere" or "Tube"
+    G4ThreeVector half;   // half-lengths of the box, the tube half-height is z
+    G4double      radius; // of the sphere or the tube
+    G4ThreeVector offset; // centre, in the local frame of the enclosed solid
+    G4double      volume;
+  };
+
+  /// Bounding shape enclosing `solid` as tightly as possible. `type` is one
+  /// of "Box", "Sphere", "Tube" or "Auto" (the one with the smallest volume)
+  BoundingSolid MakeBoundingSolid(const G4VSolid* solid, G4String type);
+
+  /// Vertex sampler bound to the dimensions of a given solid
+  using Sampler = std::function<G4ThreeVector(G4bool on_surface)>;
+
+  /// Resolve the solid type and precompute everything needed for sampling,
+  /// to be called at initialization. Calling the result does not allocate
+  Sampler MakeSampler(const G4VSolid*);
+  /// Sampler of a bounding shape, centred on the origin (not on its offset)
+  Sampler MakeSampler(const BoundingSolid&);
+
+  /// While an instance lives, the samplers of the calling thread take their
+  /// random numbers from `buffer`, filled at construction with a single call
+  /// to the engine. When it runs out they fall back to G4UniformRand(), the
+  /// numbers left over are dropped
+  class UniformBatch {
+
+    public:
+
+      UniformBatch(std::vector<G4double>& buffer);
+      ~UniformBatch();
+
+      UniformBatch           (UniformBatch const&) = delete;
+      UniformBatch& operator=(UniformBatch const&) = delete;
+      UniformBatch           (UniformBatch&&)      = delete;
+      UniformBatch& operator=(UniformBatch&&)      = delete;
+  };
+
+  /// One-off sampling, resolves the solid type at every call. Only for the
+  /// solids sampled in closed form, the ones described by a (r, z) contour
+  /// (G4Cons, G4Polycone, G4GenericPolycone, G4Polyhedra) need the
+  /// triangulation built by MakeSampler()
   G4ThreeVector rand(const G4VSolid*, G4bool on_surface=false);
 
   G4ThreeVector rand(const G4Box*, G4bool on_surface=false);
@@ -23,6 +79,50 @@ namespace RMGGeneratorUtil {
   G4ThreeVector rand(const G4Orb*, G4bool on_surface=false);
 
   G4ThreeVector rand(const G4Tubs*, G4bool on_surface=false);
+
+  G4ThreeVector rand(const G4Trd*, G4bool on_surface=false);
+
+  /**
+   * Exact sampler for solids described by a closed contour in the (r, z)
+   * plane: solids of revolution (n_sides = 0) or polyhedra with n_sides flat
+   * faces along phi, in which case r is the radius of the corners.
+   *
+   * The contour is triangulated, the density in each triangle is
+   * proportional to r (the Jacobian of both the revolution and the polygonal
+   * sweep), which is sampled exactly as a mixture of Dirichlet distributions.
+   * The surface is made of the faces swept by the contour edges plus, if the
+   * phi range is open, the two contour copies at the phi cuts.
+   */
+  class RZContourSampler {
+
+    public:
+
+      RZContourSampler(const std::vector<G4TwoVector>& contour, G4double start_phi,
+          G4double delta_phi, G4int n_sides=0);
+
+      G4ThreeVector Sample(G4bool on_surface=false) const;
+
+      inline G4double GetVolume() const { return fVolume; }
+      inline G4double GetSurface() const { return fSurface; }
+
+    private:
+
+      // point in the (r, z) plane to 3D, s in [0, 1) selects the phi position
+      G4ThreeVector Sweep(const G4TwoVector& rz, G4double s) const;
+      G4TwoVector SampleTriangle(size_t i, G4bool r_weighted) const;
+
+      std::vector<G4TwoVector>                 fContour;
+      std::vector<std::array<G4TwoVector, 3>>  fTriangles;
+      G4double                                 fStartPhi;
+      G4double                                 fDeltaPhi;
+      G4int                                    fNSides;
+      G4bool                                   fPhiCut;
+      G4double                                 fVolume;
+      G4double                                 fSurface;
+      RMGAliasTable                            fVolumeTable;    // triangles, weighted by swept volume
+      RMGAliasTable                            fAreaTable;      // triangles, weighted by area
+      RMGAliasTable                            fSurfaceTable;   // contour edges, then the two phi cuts
+  };
 }
 
 #endif
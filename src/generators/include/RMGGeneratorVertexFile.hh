@@ -0,0 +1,73 @@
+#ifndef _RMG_GENERATOR_VERTEX_FILE_HH_
+#define _RMG_GENERATOR_VERTEX_FILE_HH_
+
+#include <cstdint>
+#include <memory>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include "RMGVGeneratorPrimaryPosition.hh"
+#include "RMGMappedFile.hh"
+#include "RMGReplayCursor.hh"
+
+/**
+ * Replays primary vertices from a binary vertex file, as written by
+ * RMGGeneratorVolumeConfinement::WriteVertexFile(). The file is
+ * memory-mapped and vertices are read in place, starting from a random
+ * offset and wrapping around at the end of the file. All the threads
+ * replaying the same file share the cursor, such that no vertex is used
+ * twice before all of them have been used once.
+ *
+ * File layout (native endianness):
+ *  - a VertexFileHeader
+ *  - n_vertices records of three doubles (x, y, z), in Geant4 internal units
+ */
+class RMGGeneratorVertexFile : public RMGVGeneratorPrimaryPosition {
+
+  public:
+
+    struct VertexFileHeader {
+      char          magic[8];    // "RMGVTX\0\0"
+      std::uint32_t version;
+      std::uint32_t record_size; // bytes per vertex
+      std::uint64_t n_vertices;
+    };
+
+    static constexpr const char* kMagic = "RMGVTX";
+    static constexpr std::uint32_t kVersion = 1;
+
+    RMGGeneratorVertexFile();
+    ~RMGGeneratorVertexFile() = default;
+
+    G4ThreeVector ShootPrimaryPosition() override;
+    /// The first vertex of the event is drawn at random with the event random
+    /// engine, the following ones follow it in the file, such that the event
+    /// does not depend on the other threads
+    inline void PrepareIndependentEvent() override {
+      RMGVGeneratorPrimaryPosition::PrepareIndependentEvent();
+      fIndependentEvents = true;
+      fRandomizeCursor = true;
+    }
+
+    inline void SetFileName(G4String name) { fFileName = name; fFile.Close(); fReplayCursor.reset(); }
+    inline const G4String& GetFileName() const { return fFileName; }
+
+  private:
+
+    void OpenFile();
+
+    G4String        fFileName;
+    RMGMappedFile   fFile;
+    const G4double* fVertices;
+    std::uint64_t   fNVertices;
+    std::shared_ptr<RMGReplayCursor> fReplayCursor;
+    // private cursor, for independent events only
+    std::uint64_t   fCursor;
+    G4bool          fIndependentEvents;
+    G4bool          fRandomizeCursor;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
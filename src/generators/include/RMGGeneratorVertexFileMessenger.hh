@@ -0,0 +1,37 @@
+#ifndef _RMG_GENERATOR_VERTEX_FILE_MESSENGER_HH_
+#define _RMG_GENERATOR_VERTEX_FILE_MESSENGER_HH_
+
+#include <memory>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+
+class G4UIcommand;
+class RMGGeneratorVertexFile;
+class RMGGeneratorVertexFileMessenger : public G4UImessenger {
+
+  public:
+
+    RMGGeneratorVertexFileMessenger(RMGGeneratorVertexFile* generator);
+    ~RMGGeneratorVertexFileMessenger() = default;
+
+    RMGGeneratorVertexFileMessenger           (RMGGeneratorVertexFileMessenger const&) = delete;
+    RMGGeneratorVertexFileMessenger& operator=(RMGGeneratorVertexFileMessenger const&) = delete;
+    RMGGeneratorVertexFileMessenger           (RMGGeneratorVertexFileMessenger&&)      = delete;
+    RMGGeneratorVertexFileMessenger& operator=(RMGGeneratorVertexFileMessenger&&)      = delete;
+
+    void SetNewValue(G4UIcommand* command, G4String new_values) override;
+
+  private:
+
+    RMGGeneratorVertexFile* fGenerator;
+
+    std::unique_ptr<G4UIdirectory>      fDirectory;
+    std::unique_ptr<G4UIcmdWithAString> fFileNameCmd;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -3,16 +3,25 @@
 
 #include <vector>
 #include <regex>
+#include <memory>
+#include <cstdint>
 
 #include "globals.hh"
 #include "G4ThreeVector.hh"
 #include "G4RotationMatrix.hh"
 #include "G4Transform3D.hh"
+#include "G4Navigator.hh"
+#include "geomdefs.hh"
 
 #include "RMGVGeneratorPrimaryPosition.hh"
+#include "RMGAliasTable.hh"
+#include "RMGAcceptanceGrid.hh"
+#include "RMGGeneratorUtil.hh"
 
 class G4VPhysicalVolume;
 class G4VSolid;
+class G4Run;
+class RMGRun;
 class RMGGeneratorVolumeConfinementMessenger;
 class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
 
@@ -38,9 +47,18 @@ class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
       kUnionAll
     };
 
-    RMGGeneratorVolumeConfinement();
+    /// Composite generators owning several instances create them without
+    /// messenger, UI commands must be unique
+    RMGGeneratorVolumeConfinement(G4bool with_messenger=true);
 
     G4ThreeVector ShootPrimaryPosition() override;
+    void BeginOfRunAction(const G4Run*) override;
+    void EndOfRunAction(const G4Run*) override;
+    void PrepareIndependentEvent() override;
+
+    /// Sample n vertices and store them in a binary vertex file, to be replayed
+    /// later by RMGGeneratorVertexFile
+    void WriteVertexFile(G4String file_name, size_t n);
 
     // to be used in the messenger class
     inline void AddPhysicalVolumeNameRegex(G4String name, G4String copy_nr=".*") {
@@ -52,7 +70,11 @@ class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
     void Reset();
 
     inline void SetSamplingMode(SamplingMode mode) { fSamplingMode = mode; }
+    /// Sample on the surface of the volumes instead of in their bulk
+    inline void SetOnSurface(G4bool flag) { fOnSurface = flag; }
     inline void SetBoundingSolidType(G4String type) { fBoundingSolidType = type; }
+    inline void SetGridResolution(G4int n) { fGridResolution = n; }
+    inline void SetGridCacheDirectory(G4String dir) { fGridCacheDirectory = dir; }
 
     inline std::vector<GenericGeometricalSolidData>& GetGeometricalSolidDataList() { return fGeomVolumeData; }
 
@@ -60,15 +82,47 @@ class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
 
       SampleableObject() = default;
       SampleableObject(G4VPhysicalVolume* v, G4RotationMatrix r, G4ThreeVector t, G4VSolid* s);
-      ~SampleableObject();
-
-      G4VPhysicalVolume* physical_volume;
-      G4VSolid*          sampling_solid;
-      G4RotationMatrix   rotation;
-      G4ThreeVector      translation;
-      G4double           volume;
-      G4double           surface;
-      G4bool             containment_check;
+      ~SampleableObject() = default;
+
+      // sets the global transformation and caches its inverse
+      void SetTransformation(const G4RotationMatrix& r, const G4ThreeVector& t);
+      // kInside/kOutside if the local frame test is conclusive, kSurface otherwise
+      EInside Inside(const G4ThreeVector& point, G4bool on_surface=false) const;
+      EInside InsideLocalFrame(const G4ThreeVector& local_point, G4bool on_surface=false) const;
+      G4String GetName() const;
+      // classification of a grid cell by means of safety distances
+      RMGAcceptanceGrid::CellType ClassifyCell(const G4ThreeVector& center, G4double half_diagonal) const;
+      // identifies the solid, its daughters and their placements
+      std::uint64_t GeometryHash() const;
+
+      // daughter volume placement, in the mother local frame
+      struct Daughter {
+        const G4VSolid*  solid;
+        G4RotationMatrix inverse_rotation;
+        G4ThreeVector    translation;
+      };
+
+      G4VPhysicalVolume*    physical_volume;
+      G4VSolid*             sampling_solid;  // null if sampled through a bounding shape
+      G4ThreeVector         sampling_offset; // of the sampled shape, in the local frame
+      RMGGeneratorUtil::Sampler sampler;     // bound to the sampled shape
+      G4RotationMatrix      rotation;
+      G4ThreeVector         translation;
+      G4RotationMatrix      inverse_rotation;
+      G4int                 copy_no; // of the touchable, for replicated or parameterised volumes
+      std::vector<Daughter> daughters;
+      G4double              volume;
+      G4double              surface;
+      G4bool                containment_check;
+      G4bool                navigator_only; // local frame test not possible (replicas, parameterisations)
+      // optional, replaces the sampling solid for volume sampling
+      std::shared_ptr<const RMGAcceptanceGrid> grid; // shared between threads
+
+      // accepted vertices of the last batch, still to be used
+      std::vector<G4ThreeVector> vertex_buffer;
+      // counters of the current run, set at the first batch
+      G4double*                  run_n_trials = nullptr;
+      G4double*                  run_n_accepted = nullptr;
     };
 
     struct SampleableObjectCollection {
@@ -76,26 +130,45 @@ class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
       inline SampleableObjectCollection() : total_volume(0), total_surface(0) {}
       inline ~SampleableObjectCollection() { data.clear(); }
 
-      const SampleableObject& SurfaceWeightedRand();
-      const SampleableObject& VolumeWeightedRand();
+      SampleableObject& SurfaceWeightedRand();
+      SampleableObject& VolumeWeightedRand();
       G4bool IsInside(const G4ThreeVector& point);
+      G4bool IsInsideWithNavigator(const SampleableObject& o, const G4ThreeVector& point);
+      // must be called once the collection is complete, before drawing
+      void BuildAliasTables();
 
       // emulate std::vector
       void emplace_back(G4VPhysicalVolume* v, G4RotationMatrix& r, G4ThreeVector& t, G4VSolid* s);
       void emplace_back(G4VPhysicalVolume* v, G4RotationMatrix r, G4ThreeVector t, G4VSolid* s);
       inline G4bool empty() { return data.empty(); }
       inline SampleableObject& back() { return data.back(); }
-      inline void clear() { data.clear(); }
+      inline void clear() {
+        data.clear();
+        volume_alias_table.clear();
+        surface_alias_table.clear();
+        total_volume = 0;
+        total_surface = 0;
+      }
 
       std::vector<SampleableObject> data;
       G4double total_volume;
       G4double total_surface;
+      RMGAliasTable volume_alias_table;
+      RMGAliasTable surface_alias_table;
+      // private navigator, used only if the local frame test is inconclusive.
+      // never use the tracking navigator here, its state is needed by the tracking
+      std::unique_ptr<G4Navigator> navigator;
     };
 
   private:
 
     void InitializePhysicalVolumes();
     void InitializeGeometricalVolumes();
+    void BuildAcceptanceGrid(SampleableObject& o);
+    void FillVertexBuffer(SampleableObject& o, SampleableObjectCollection& collection);
+    G4bool ShootInObject(SampleableObject& o, SampleableObjectCollection& collection,
+        G4ThreeVector& vertex, G4int& calls);
+    static void PrintRunSummary(const RMGRun& run);
 
     std::vector<G4String> fPhysicalVolumeNameRegexes;
     std::vector<G4String> fPhysicalVolumeCopyNrRegexes;
@@ -107,6 +180,13 @@ class RMGGeneratorVolumeConfinement : public RMGVGeneratorPrimaryPosition {
     SamplingMode fSamplingMode;
     G4bool       fOnSurface;
     G4String     fBoundingSolidType;
+    G4int        fGridResolution; // zero means no grid
+    G4String     fGridCacheDirectory;
+
+    size_t                     fVertexBatchSize;
+    std::vector<G4ThreeVector> fLocalCandidates;
+    std::vector<G4double>      fUniforms; // drawn at once for a batch of candidates
+    RMGRun*                    fRun;      // the acceptance is counted in it
 };
 
 #endif
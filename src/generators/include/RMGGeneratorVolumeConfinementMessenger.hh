@@ -7,8 +7,10 @@
 #include "globals.hh"
 #include "G4UImessenger.hh"
 #include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithABool.hh"
 #include "G4UIcmdWith3VectorAndUnit.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
 
@@ -36,6 +38,7 @@ class RMGGeneratorVolumeConfinementMessenger : public G4UImessenger {
 
    std::unique_ptr<G4UIcmdWithAString>        fSamplingModeCmd;
    std::unique_ptr<G4UIcmdWithAString>        fBoundingSolidTypeCmd;
+   std::unique_ptr<G4UIcmdWithABool>          fSampleOnSurfaceCmd;
 
    std::unique_ptr<G4UIcmdWithAString>        fAddPhysVolCmd;
    std::unique_ptr<G4UIcmdWithAString>        fAddGeomVolCmd;
@@ -55,6 +58,11 @@ class RMGGeneratorVolumeConfinementMessenger : public G4UImessenger {
 
    std::unique_ptr<G4UIcmdWith3VectorAndUnit> fGeomVolCenterCmd;
    std::unique_ptr<G4UIcmdWithAnInteger>      fNPositionsamplingMaxCmd;
+   std::unique_ptr<G4UIcmdWithAnInteger>      fVertexPoolSizeCmd;
+   std::unique_ptr<G4UIcommand>               fWriteVertexFileCmd;
+
+   std::unique_ptr<G4UIcmdWithAnInteger>      fGridResolutionCmd;
+   std::unique_ptr<G4UIcmdWithAString>        fGridCacheDirectoryCmd;
 };
 
 #endif
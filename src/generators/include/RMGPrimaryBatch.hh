@@ -0,0 +1,73 @@
+#ifndef _RMG_PRIMARY_BATCH_HH_
+#define _RMG_PRIMARY_BATCH_HH_
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class G4Event;
+class G4ParticleDefinition;
+
+/**
+ * Primaries of a block of upcoming events, stored as structure of arrays.
+ *
+ * The vertices are filled first (one per event), then generators append the
+ * primary particles of each event in order and close it with CloseEvent().
+ * Columns are contiguous such that batch capable generators can fill them
+ * with vectorized kernels, the per event cost is then reduced to the
+ * construction of the G4PrimaryVertex in FillEvent()
+ */
+class RMGPrimaryBatch {
+
+  public:
+
+    inline RMGPrimaryBatch() : first_primary(1, 0) {}
+    ~RMGPrimaryBatch() = default;
+
+    void Reserve(size_t n_events, size_t n_primaries_per_event=1);
+    void Clear();
+
+    void AddVertex(const G4ThreeVector& position, G4double time=0, G4double weight=1);
+    /// Append a primary to the first event that has not been closed yet. The
+    /// time is relative to the one of the event vertex
+    void AddPrimary(const G4ParticleDefinition* particle, const G4ThreeVector& momentum,
+        G4double charge, const G4ThreeVector& polarization=G4ThreeVector(0, 0, 0), G4double time=0);
+    void CloseEvent();
+
+    /// Fill the primaries of the i-th event of the batch into the Geant4 event,
+    /// consecutive primaries with the same time share a G4PrimaryVertex. The
+    /// event weight is stored in the RMGEventInformation
+    void FillEvent(size_t i, G4Event* event) const;
+
+    inline size_t GetNumberOfEvents() const { return vertex_x.size(); }
+    inline size_t GetNumberOfClosedEvents() const { return first_primary.size() - 1; }
+    inline size_t GetNumberOfPrimaries() const { return particle.size(); }
+    inline size_t GetNumberOfPrimaries(size_t i) const { return first_primary[i+1] - first_primary[i]; }
+    inline G4ThreeVector GetPosition(size_t i) const {
+      return G4ThreeVector(vertex_x[i], vertex_y[i], vertex_z[i]);
+    }
+
+    // per event columns
+    std::vector<G4double> vertex_x;
+    std::vector<G4double> vertex_y;
+    std::vector<G4double> vertex_z;
+    std::vector<G4double> vertex_t;
+    std::vector<G4double> weight;
+    std::vector<size_t>   first_primary; // number of closed events + 1 entries
+
+    // per primary columns
+    std::vector<const G4ParticleDefinition*> particle;
+    std::vector<G4double> px;
+    std::vector<G4double> py;
+    std::vector<G4double> pz;
+    std::vector<G4double> charge;
+    std::vector<G4double> pol_x;
+    std::vector<G4double> pol_y;
+    std::vector<G4double> pol_z;
+    std::vector<G4double> time;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
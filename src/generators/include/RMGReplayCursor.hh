@@ -0,0 +1,67 @@
+#ifndef _RMG_REPLAY_CURSOR_HH_
+#define _RMG_REPLAY_CURSOR_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "globals.hh"
+
+/**
+ * Position in the sequence of entries of a replayed file, shared by all the
+ * threads replaying the same file. Each call to Next() hands out a different
+ * entry until all of them have been used, then the sequence wraps around.
+ * The sequence starts at a random entry, drawn by the first call to Next().
+ * Readers picking their entries themselves (see Count()) never draw it, they
+ * do not perturb the random stream of their events.
+ */
+class RMGReplayCursor {
+
+  public:
+
+    /// Cursor shared by all the current readers of `file_name`. A new one is
+    /// made once nobody holds the previous one anymore, or if the number of
+    /// entries changed (i.e. the file was rewritten)
+    static std::shared_ptr<RMGReplayCursor> Get(const G4String& file_name, std::uint64_t n_entries);
+
+    RMGReplayCursor           (RMGReplayCursor const&) = delete;
+    RMGReplayCursor& operator=(RMGReplayCursor const&) = delete;
+    RMGReplayCursor           (RMGReplayCursor&&)      = delete;
+    RMGReplayCursor& operator=(RMGReplayCursor&&)      = delete;
+    ~RMGReplayCursor() = default;
+
+    /// Index of the next entry. `first_repeat` is set by the single call,
+    /// among all threads, which starts reusing entries
+    inline std::uint64_t Next(G4bool& first_repeat) {
+      std::call_once(fStartDrawn, &RMGReplayCursor::DrawStart, this);
+      auto n = fNServed.fetch_add(1, std::memory_order_relaxed);
+      first_repeat = n == fNEntries;
+      return (fStart + n % fNEntries) % fNEntries;
+    }
+
+    /// Counts an entry picked by the caller, e.g. at random. Returns true for
+    /// the single call, among all threads, after which entries are reused
+    inline G4bool Count() {
+      return fNServed.fetch_add(1, std::memory_order_relaxed) == fNEntries;
+    }
+
+    inline std::uint64_t GetNEntries() const { return fNEntries; }
+
+  private:
+
+    RMGReplayCursor(std::uint64_t n_entries) :
+      fNEntries(n_entries), fStart(0), fNServed(0) {}
+
+    // with the random engine of the calling thread
+    void DrawStart();
+
+    const std::uint64_t        fNEntries;
+    std::uint64_t              fStart;
+    std::once_flag             fStartDrawn;
+    std::atomic<std::uint64_t> fNServed;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -9,6 +9,7 @@
 
 class G4Event;
 class G4Run;
+class RMGPrimaryBatch;
 class RMGVGenerator {
 
   public:
@@ -30,6 +31,26 @@ class RMGVGenerator {
     virtual inline void EndOfRunAction(const G4Run*) {};
     virtual void GeneratePrimaryVertex(G4Event*) = 0;
     virtual void SetParticlePosition(G4ThreeVector vec) = 0;
+    /// Generators placing the vertices themselves override this, the primary
+    /// position generator is then not used at all
+    virtual inline G4bool PlacesOwnVertices() const { return false; }
+
+    /// Generators able to fill the primaries of many events at once override
+    /// both methods. The batch comes with one vertex per event already set,
+    /// the generator appends the primary particles of each event to it
+    virtual inline G4bool IsBatchCapable() const { return false; }
+    virtual inline void GeneratePrimaryBatch(RMGPrimaryBatch&) {};
+
+    /// Statistical weight of the last generated event, biased generators
+    /// override this. Batch capable generators multiply the event weights
+    /// in the batch instead
+    virtual inline G4double GetEventWeight() const { return 1; }
+
+    /// Called before the random engine is re-seeded for each event, see
+    /// RMGManager::SetPerEventSeeding(). Anything carried over from previous
+    /// events must be dropped, such that the event only depends on its seed
+    virtual inline void PrepareIndependentEvent() {};
+
     inline void SetReportingFrequency(G4int freq) { fReportingFrequency = freq; }
     inline G4String GetGeneratorName() { return fGeneratorName; }
 
@@ -2,18 +2,25 @@
 #define _RMGGENERATORPRIMARYPOSITION_HH_
 
 #include <memory>
+#include <vector>
 
 #include "globals.hh"
 #include "G4ThreeVector.hh"
 #include "G4UImessenger.hh"
 
+#include "RMGLog.hh"
+
+class G4Run;
 class RMGVGeneratorPrimaryPosition {
 
   public:
 
     inline RMGVGeneratorPrimaryPosition(G4String name) :
       fGeneratorName(name),
-      fMaxAttempts(100000) {}
+      fMaxAttempts(100000),
+      fVertexPoolSize(0),
+      fVertexPoolCursor(0),
+      fVertexWeight(1) {}
 
     virtual inline ~RMGVGeneratorPrimaryPosition() = default;
 
@@ -22,10 +29,59 @@ class RMGVGeneratorPrimaryPosition {
     RMGVGeneratorPrimaryPosition           (RMGVGeneratorPrimaryPosition&&)      = delete;
     RMGVGeneratorPrimaryPosition& operator=(RMGVGeneratorPrimaryPosition&&)      = delete;
 
+    // derived classes overriding this must call it, the vertex pool is
+    // dropped at the start of each run to make runs reproducible on their own
+    virtual inline void BeginOfRunAction(const G4Run*) { this->ClearVertexPool(); };
+    virtual inline void EndOfRunAction(const G4Run*) {};
     virtual inline G4ThreeVector ShootPrimaryPosition() { return kDummyPrimaryPosition; }
+    /// Statistical weight of the vertex last returned by ShootPrimaryPosition(),
+    /// one for unbiased sampling. Samplers with varying weights override this
+    virtual inline G4double GetShotVertexWeight() const { return 1; }
+    /// Statistical weight of the vertex last returned by NextPrimaryPosition()
+    inline G4double GetVertexWeight() const { return fVertexWeight; }
+    /// Same as RMGVGenerator::PrepareIndependentEvent(). An event seeded on
+    /// its own would use only the first vertex of a refilled pool, the pool
+    /// cannot be used with per-event seeding
+    virtual inline void PrepareIndependentEvent() {
+      if (fVertexPoolSize > 0) {
+        RMGLog::Out(RMGLog::fatal, "Generator '", fGeneratorName, "': the vertex pool cannot be ",
+            "used with per-event seeding, set its size to zero");
+      }
+    }
     inline void SetMaxAttempts(G4int val) { fMaxAttempts = val; }
     inline G4int GetMaxAttempts() { return fMaxAttempts; }
 
+    /// Next vertex from the pool, or directly from ShootPrimaryPosition() if
+    /// the pool is disabled. The pool is refilled in blocks on the calling
+    /// (worker) thread with its own random engine, hence the random stream is
+    /// reproducible for a fixed seed. The weight of each vertex is pooled
+    /// with it
+    inline G4ThreeVector NextPrimaryPosition() {
+      if (fVertexPoolSize == 0) {
+        auto vertex = this->ShootPrimaryPosition();
+        fVertexWeight = this->GetShotVertexWeight();
+        return vertex;
+      }
+      if (fVertexPoolCursor >= fVertexPool.size()) {
+        fVertexPool.resize(fVertexPoolSize);
+        fVertexPoolWeights.resize(fVertexPoolSize);
+        for (size_t i = 0; i < fVertexPoolSize; ++i) {
+          fVertexPool[i] = this->ShootPrimaryPosition();
+          fVertexPoolWeights[i] = this->GetShotVertexWeight();
+        }
+        fVertexPoolCursor = 0;
+      }
+      fVertexWeight = fVertexPoolWeights[fVertexPoolCursor];
+      return fVertexPool[fVertexPoolCursor++];
+    }
+    inline void SetVertexPoolSize(size_t n) { fVertexPoolSize = n; this->ClearVertexPool(); }
+    inline size_t GetVertexPoolSize() { return fVertexPoolSize; }
+    inline void ClearVertexPool() {
+      fVertexPool.clear();
+      fVertexPoolWeights.clear();
+      fVertexPoolCursor = 0;
+    }
+
   protected:
 
     G4String fGeneratorName;
@@ -33,6 +89,14 @@ class RMGVGeneratorPrimaryPosition {
     const G4ThreeVector kDummyPrimaryPosition = G4ThreeVector(0, 0, 0);
 
     std::unique_ptr<G4UImessenger> fG4Messenger;
+
+  private:
+
+    size_t                     fVertexPoolSize; // zero means no pool
+    std::vector<G4ThreeVector> fVertexPool;
+    std::vector<G4double>      fVertexPoolWeights;
+    size_t                     fVertexPoolCursor;
+    G4double                   fVertexWeight; // of the last vertex handed out
 };
 
 #endif
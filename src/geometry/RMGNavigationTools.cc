@@ -1,47 +1,99 @@
 #include "RMGNavigationTools.hh"
 
-#include <set>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include "G4PhysicalVolumeStore.hh"
-#include "G4LogicalVolume.hh"
+#include "G4AutoLock.hh"
 
+#include "RMGTouchableTransformTable.hh"
 #include "RMGLog.hh"
 
-G4VPhysicalVolume* RMGNavigationTools::FindDirectMother(G4VPhysicalVolume* volume) {
+namespace {
 
-  std::set<G4VPhysicalVolume*> ancestors;
-  for (const auto& v : *G4PhysicalVolumeStore::GetInstance()) {
-    if (v->GetLogicalVolume()->IsAncestor(volume)) ancestors.insert(v);
+  // the world volume is published atomically, readers do not need the lock.
+  // The mothers and global transformations come from the touchable table
+  G4Mutex gVolumeIndexMutex = G4MUTEX_INITIALIZER;
+  std::atomic<G4VPhysicalVolume*> gWorldVolume(nullptr);
+
+  // with the lock held
+  void BuildVolumeIndexLocked() {
+
+    G4VPhysicalVolume* world = nullptr;
+    for (const auto& v : *G4PhysicalVolumeStore::GetInstance()) {
+      if (v->GetMotherLogical()) continue;
+      if (world) RMGLog::Out(RMGLog::warning, "More than one volume without mother found");
+      else world = v;
+    }
+    if (!world) RMGLog::Out(RMGLog::error, "No world volume found in the physical volume store");
+
+    gWorldVolume.store(world, std::memory_order_release);
+  }
+
+  // the first touchable of a placement, null if it is not in the geometry tree
+  const RMGTouchableTransformTable::Touchable* FindFirstTouchable(const G4VPhysicalVolume* volume,
+      std::shared_ptr<const RMGTouchableTransformTable>& table) {
+
+    table = RMGTouchableTransformTable::Get({volume});
+    auto range = table->Find(volume);
+    return range.empty() ? nullptr : &table->GetTouchable(*range.begin());
   }
+}
+
+void RMGNavigationTools::BuildVolumeIndex() {
+
+  G4AutoLock lock(&gVolumeIndexMutex);
+  BuildVolumeIndexLocked();
+}
+
+void RMGNavigationTools::ClearVolumeIndex() {
 
-  if (ancestors.empty()) {
+  G4AutoLock lock(&gVolumeIndexMutex);
+  gWorldVolume.store(nullptr, std::memory_order_release);
+}
+
+G4VPhysicalVolume* RMGNavigationTools::GetWorldVolume() {
+
+  auto world = gWorldVolume.load(std::memory_order_acquire);
+  if (world) return world;
+
+  G4AutoLock lock(&gVolumeIndexMutex);
+  // another thread may have built it while we were waiting for the lock
+  if (!gWorldVolume.load(std::memory_order_relaxed)) BuildVolumeIndexLocked();
+  return gWorldVolume.load(std::memory_order_relaxed);
+}
+
+G4VPhysicalVolume* RMGNavigationTools::FindDirectMother(G4VPhysicalVolume* volume) {
+
+  std::shared_ptr<const RMGTouchableTransformTable> table;
+  auto touchable = FindFirstTouchable(volume, table);
+  if (!touchable) {
+    RMGLog::Out(RMGLog::error, "Physical volume '", volume->GetName(), "' is not placed in the ",
+        "world volume, returning nullptr");
+    return nullptr;
+  }
+  if (touchable->mother < 0) {
     RMGLog::Out(RMGLog::error, "No ancestors found for physical volume '",
         volume->GetName(), "', returning nullptr");
+    return nullptr;
   }
 
-  // check elements one-by-one
-  for (auto it = ancestors.begin(); it != ancestors.end(); ) {
-    // determine if element should be erased or not because it is an ancestor
-    // of someone else in the list
-    G4bool to_erase = false;
-    for (auto itt = ancestors.begin(); itt != ancestors.end(); ) {
-      if (*it != *itt and (*it)->GetLogicalVolume()->IsAncestor(*itt)) {
-        to_erase = true;
-        break;
-      }
-      else itt++;
-    }
-    if (to_erase) it = ancestors.erase(it);
-    else it++;
-  }
+  return table->GetTouchable(touchable->mother).volume;
+}
+
+void RMGNavigationTools::GetGlobalTransformation(const G4VPhysicalVolume* volume,
+    G4RotationMatrix& rotation, G4ThreeVector& translation) {
 
-  if (ancestors.size() != 1) {
-    RMGLog::Out(RMGLog::error, "Could not find a unique direct mother volume, ",
-        "this cannot be! Returning first ancestor in the list");
+  std::shared_ptr<const RMGTouchableTransformTable> table;
+  auto touchable = FindFirstTouchable(volume, table);
+  if (!touchable) {
+    RMGLog::Out(RMGLog::fatal, "Physical volume '", volume->GetName(), "' is not placed in the ",
+        "world volume");
   }
 
-  return *ancestors.begin();
+  rotation = touchable->rotation;
+  translation = touchable->translation;
 }
 
 void RMGNavigationTools::PrintListOfPhysicalVolumes() {
@@ -0,0 +1,149 @@
+#include "RMGTouchableTransformTable.hh"
+
+#include <algorithm>
+
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPVParameterisation.hh"
+#include "G4ReplicaNavigation.hh"
+#include "G4AutoLock.hh"
+
+#include "RMGNavigationTools.hh"
+#include "RMGLog.hh"
+
+namespace {
+
+  // compares table indices by copy number, for binary searches
+  struct CopyNoLess {
+    const std::vector<RMGTouchableTransformTable::Touchable>* touchables;
+    bool operator()(size_t i, G4int copy_no) const { return (*touchables)[i].copy_no < copy_no; }
+    bool operator()(G4int copy_no, size_t i) const { return copy_no < (*touchables)[i].copy_no; }
+  };
+
+  G4Mutex gTableMutex = G4MUTEX_INITIALIZER;
+  // the last table built and the placements it covers
+  std::shared_ptr<const RMGTouchableTransformTable> gTable;
+  std::set<const G4VPhysicalVolume*> gTargets;
+
+  // whether the subtree of a logical volume contains one of the targets,
+  // memoised as logical volumes are usually placed more than once
+  G4bool LeadsToTarget(const G4LogicalVolume* log_vol, const std::set<const G4VPhysicalVolume*>& targets,
+      std::unordered_map<const G4LogicalVolume*, G4bool>& cache) {
+
+    auto it = cache.find(log_vol);
+    if (it != cache.end()) return it->second;
+
+    G4bool leads = false;
+    for (G4int d = 0; d < log_vol->GetNoDaughters() and !leads; ++d) {
+      auto daughter = log_vol->GetDaughter(d);
+      leads = targets.count(daughter) or LeadsToTarget(daughter->GetLogicalVolume(), targets, cache);
+    }
+    cache.emplace(log_vol, leads);
+    return leads;
+  }
+}
+
+std::shared_ptr<const RMGTouchableTransformTable> RMGTouchableTransformTable::Get(
+    const std::vector<const G4VPhysicalVolume*>& volumes) {
+
+  G4AutoLock lock(&gTableMutex);
+
+  auto n_targets = gTargets.size();
+  gTargets.insert(volumes.begin(), volumes.end());
+  if (gTable and gTargets.size() == n_targets) return gTable;
+
+  gTable = std::shared_ptr<const RMGTouchableTransformTable>(
+      new RMGTouchableTransformTable(RMGNavigationTools::GetWorldVolume(), gTargets));
+  return gTable;
+}
+
+RMGTouchableTransformTable::RMGTouchableTransformTable(G4VPhysicalVolume* world,
+    const std::set<const G4VPhysicalVolume*>& targets) {
+
+  if (!world) RMGLog::Out(RMGLog::fatal, "Cannot build the touchable table without world volume");
+
+  fTouchables.push_back({world, world->GetCopyNo(), 0, -1,
+      world->GetObjectRotationValue(), world->GetObjectTranslation()});
+
+  G4ReplicaNavigation replica_navigation;
+  std::unordered_map<const G4LogicalVolume*, G4bool> leads_to_target;
+
+  // breadth-first: the mother of each touchable is in the table before it
+  for (size_t i = 0; i < fTouchables.size(); ++i) {
+
+    auto log_vol = fTouchables[i].volume->GetLogicalVolume();
+
+    for (G4int d = 0; d < log_vol->GetNoDaughters(); ++d) {
+      auto daughter = log_vol->GetDaughter(d);
+      if (!targets.count(daughter) and !LeadsToTarget(daughter->GetLogicalVolume(), targets, leads_to_target)) {
+        continue;
+      }
+
+      G4int n_copies = 1;
+      if (daughter->IsReplicated()) {
+        EAxis axis; G4double width, offset; G4bool consuming;
+        daughter->GetReplicationData(axis, n_copies, width, offset, consuming);
+      }
+
+      for (G4int c = 0; c < n_copies; ++c) {
+        G4int copy_no = daughter->GetCopyNo();
+        // move the daughter to the position of the copy
+        if (daughter->IsParameterised()) {
+          daughter->GetParameterisation()->ComputeTransformation(c, daughter);
+          copy_no = c;
+        }
+        else if (daughter->IsReplicated()) {
+          replica_navigation.ComputeTransformation(c, daughter);
+          copy_no = c;
+        }
+
+        // do not keep references across iterations, push_back() reallocates
+        const auto& mother = fTouchables[i];
+        auto local_rotation = daughter->GetObjectRotationValue();
+        auto local_translation = daughter->GetObjectTranslation();
+
+        fTouchables.push_back({daughter, copy_no, mother.depth + 1, static_cast<G4long>(i),
+            mother.rotation * local_rotation, mother.rotation * local_translation + mother.translation});
+      }
+    }
+  }
+
+  fSortedIndices.resize(fTouchables.size());
+  for (size_t i = 0; i < fSortedIndices.size(); ++i) fSortedIndices[i] = i;
+  std::stable_sort(fSortedIndices.begin(), fSortedIndices.end(), [this](size_t a, size_t b) {
+    const auto& ta = fTouchables[a];
+    const auto& tb = fTouchables[b];
+    if (ta.volume != tb.volume) return std::less<const G4VPhysicalVolume*>()(ta.volume, tb.volume);
+    return ta.copy_no < tb.copy_no;
+  });
+
+  for (size_t i = 0; i < fSortedIndices.size(); ) {
+    auto volume = fTouchables[fSortedIndices[i]].volume;
+    auto j = i;
+    while (j < fSortedIndices.size() and fTouchables[fSortedIndices[j]].volume == volume) ++j;
+    fRanges.emplace(volume, std::make_pair(i, j));
+    i = j;
+  }
+
+  RMGLog::Out(RMGLog::detail, "Touchable transform table built for ", targets.size(),
+      " placements: ", fTouchables.size(), " touchables");
+}
+
+RMGTouchableTransformTable::Range RMGTouchableTransformTable::Find(const G4VPhysicalVolume* volume) const {
+
+  auto it = fRanges.find(volume);
+  if (it == fRanges.end()) return {nullptr, nullptr};
+
+  return {fSortedIndices.data() + it->second.first, fSortedIndices.data() + it->second.second};
+}
+
+RMGTouchableTransformTable::Range RMGTouchableTransformTable::Find(const G4VPhysicalVolume* volume,
+    G4int copy_no) const {
+
+  auto all = this->Find(volume);
+  auto range = std::equal_range(all.first, all.last, copy_no, CopyNoLess{&fTouchables});
+
+  return {range.first, range.second};
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -2,10 +2,32 @@
 #define _RMG_NAVIGATION_TOOLS_HH_
 
 #include "G4VPhysicalVolume.hh"
+#include "G4RotationMatrix.hh"
+#include "G4ThreeVector.hh"
 
 namespace RMGNavigationTools {
 
+  /// Find the world volume in the physical volume store. Must be called after
+  /// the geometry is constructed (or modified), it is otherwise done on first
+  /// use. Rebuilding replaces the world volume seen by all threads, it is
+  /// only safe before the worker threads start tracking
+  void BuildVolumeIndex();
+  void ClearVolumeIndex();
+
+  G4VPhysicalVolume* GetWorldVolume();
+
+  /// Mother placement of a placement, from the touchable table (see
+  /// RMGTouchableTransformTable). Logical volumes placed more than once are
+  /// followed along their first touchable. May build the table, must not be
+  /// called while tracking
   G4VPhysicalVolume* FindDirectMother(G4VPhysicalVolume* volume);
+
+  /// Transformation from the local frame of a placement to the world frame:
+  /// p_global = rotation * p_local + translation, of its first touchable.
+  /// May build the touchable table, must not be called while tracking
+  void GetGlobalTransformation(const G4VPhysicalVolume* volume,
+      G4RotationMatrix& rotation, G4ThreeVector& translation);
+
   void PrintListOfPhysicalVolumes();
 
 }
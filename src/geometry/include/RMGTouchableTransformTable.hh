@@ -0,0 +1,93 @@
+#ifndef _RMG_TOUCHABLE_TRANSFORM_TABLE_HH_
+#define _RMG_TOUCHABLE_TRANSFORM_TABLE_HH_
+
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "globals.hh"
+#include "G4RotationMatrix.hh"
+#include "G4ThreeVector.hh"
+#include "G4AffineTransform.hh"
+
+class G4VPhysicalVolume;
+/**
+ * Global transformation of the touchables of selected placements, i.e. of
+ * every distinct placement path from the world volume down to them.
+ * Replicated and parameterised volumes contribute one touchable per copy,
+ * logical volumes placed more than once one per placement of their mother.
+ *
+ * Only the branches of the geometry tree leading to the requested placements
+ * are expanded, the copies of a replicated or parameterised volume elsewhere
+ * (e.g. the voxels of a phantom nobody samples from) are not enumerated.
+ * Tables are immutable once built and handed out as shared pointers, hence
+ * safe to share among threads. Requesting more placements builds a new
+ * table, the ones already handed out stay valid.
+ */
+class RMGTouchableTransformTable {
+
+  public:
+
+    struct Touchable {
+      G4VPhysicalVolume* volume;
+      G4int              copy_no;
+      G4int              depth;    // zero for the world volume
+      G4long             mother;   // index in the table, -1 for the world volume
+      G4RotationMatrix   rotation; // p_global = rotation * p_local + translation
+      G4ThreeVector      translation;
+
+      // local to global, for G4AffineTransform::TransformPoint()
+      inline G4AffineTransform GetAffineTransform() const {
+        return G4AffineTransform(rotation.inverse(), translation);
+      }
+    };
+
+    /// Contiguous range of table indices, valid as long as the table is
+    struct Range {
+      const size_t* first;
+      const size_t* last;
+
+      inline const size_t* begin() const { return first; }
+      inline const size_t* end() const { return last; }
+      inline size_t size() const { return last - first; }
+      inline G4bool empty() const { return first == last; }
+    };
+
+    /// Table covering at least the touchables of `volumes`. Builds a new one
+    /// on the calling thread if some of them are not covered yet, which moves
+    /// replicated and parameterised volumes around: must not be called while
+    /// this thread is tracking
+    static std::shared_ptr<const RMGTouchableTransformTable> Get(
+        const std::vector<const G4VPhysicalVolume*>& volumes);
+
+    RMGTouchableTransformTable           (RMGTouchableTransformTable const&) = delete;
+    RMGTouchableTransformTable& operator=(RMGTouchableTransformTable const&) = delete;
+    RMGTouchableTransformTable           (RMGTouchableTransformTable&&)      = delete;
+    RMGTouchableTransformTable& operator=(RMGTouchableTransformTable&&)      = delete;
+    ~RMGTouchableTransformTable() = default;
+
+    inline const std::vector<Touchable>& GetTouchables() const { return fTouchables; }
+    inline const Touchable& GetTouchable(size_t i) const { return fTouchables[i]; }
+
+    /// Indices of the touchables of a placement, all copy numbers, sorted by
+    /// copy number. Does not allocate
+    Range Find(const G4VPhysicalVolume* volume) const;
+    /// Indices of the touchables of a placement with a given copy number
+    Range Find(const G4VPhysicalVolume* volume, G4int copy_no) const;
+
+  private:
+
+    RMGTouchableTransformTable(G4VPhysicalVolume* world, const std::set<const G4VPhysicalVolume*>& targets);
+
+    std::vector<Touchable> fTouchables;
+    // touchable indices sorted by volume and copy number, each volume owns a
+    // contiguous range of it
+    std::vector<size_t>    fSortedIndices;
+    std::unordered_map<const G4VPhysicalVolume*, std::pair<size_t, size_t>> fRanges;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
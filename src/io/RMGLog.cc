@@ -151,16 +151,18 @@ bool RMGLog::SupportsColors(const std::ostream& os) {
 /// ---------------------------------------------------------
 
 // https://codereview.stackexchange.com/questions/187183/create-a-c-string-using-printf-style-formatting
-void RMGLog::OutFormat(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevelscreen, const char *fmt, ...) {
+void RMGLog::OutFormatV(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevelscreen, const char *fmt, va_list args) {
+
+  // the argument list is consumed by each formatting attempt
+  va_list args_copy;
+  va_copy(args_copy, args);
 
   char buf[256];
-  va_list args;
-  va_start(args, fmt);
   const auto r = std::vsnprintf(buf, sizeof buf, fmt, args);
-  va_end(args);
 
   // conversion failed
   if (r < 0) {
+    va_end(args_copy);
     RMGLog::Out(RMGLog::error, "Formatting error");
     return;
   }
@@ -168,16 +170,25 @@ void RMGLog::OutFormat(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevels
   // we fit in the buffer
   const size_t len = r;
   if (len < sizeof buf) {
+    va_end(args_copy);
     RMGLog::Out(loglevelfile, loglevelscreen, std::string{buf, len});
     return;
   }
 
   // we need to allocate scratch memory
   auto vbuf = std::unique_ptr<char[]>(new char[len+1]);
+  std::vsnprintf(vbuf.get(), len+1, fmt, args_copy);
+  va_end(args_copy);
+  RMGLog::Out(loglevelfile, loglevelscreen, std::string{vbuf.get(), len});
+}
+
+// ---------------------------------------------------------
+
+void RMGLog::OutFormat(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevelscreen, const char *fmt, ...) {
+  va_list args;
   va_start(args, fmt);
-  std::vsnprintf(vbuf.get(), len+1, fmt, args);
+  RMGLog::OutFormatV(loglevelfile, loglevelscreen, fmt, args);
   va_end(args);
-  RMGLog::Out(loglevelfile, loglevelscreen, std::string{vbuf.get(), len});
 }
 
 // ---------------------------------------------------------
@@ -185,7 +196,7 @@ void RMGLog::OutFormat(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevels
 void RMGLog::OutFormat(RMGLog::LogLevel loglevel, const char *fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  RMGLog::OutFormat(loglevel, loglevel, fmt, args);
+  RMGLog::OutFormatV(loglevel, loglevel, fmt, args);
   va_end(args);
 }
 
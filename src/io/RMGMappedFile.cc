@@ -0,0 +1,62 @@
+#include "RMGMappedFile.hh"
+
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "RMGLog.hh"
+
+RMGMappedFile::RMGMappedFile(G4String file_name) {
+  this->Open(file_name);
+}
+
+RMGMappedFile::~RMGMappedFile() {
+  this->Close();
+}
+
+G4bool RMGMappedFile::Open(G4String file_name) {
+
+  this->Close();
+
+  auto fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    RMGLog::Out(RMGLog::error, "Could not open file '", file_name, "': ", std::strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 or st.st_size == 0) {
+    RMGLog::Out(RMGLog::error, "Could not determine size of file '", file_name, "' or file is empty");
+    close(fd);
+    return false;
+  }
+
+  auto addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+
+  if (addr == MAP_FAILED) {
+    RMGLog::Out(RMGLog::error, "Could not memory-map file '", file_name, "': ", std::strerror(errno));
+    return false;
+  }
+
+  fFileName = file_name;
+  fData = static_cast<const char*>(addr);
+  fSize = st.st_size;
+
+  RMGLog::OutFormat(RMGLog::detail, "Memory-mapped file '%s' (%.1f MB)", file_name.c_str(), fSize/1.e6);
+
+  return true;
+}
+
+void RMGMappedFile::Close() {
+  if (fData) munmap(const_cast<char*>(fData), fSize);
+  fData = nullptr;
+  fSize = 0;
+  fFileName = "";
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,839 @@
+#include "RMGOutputManagerHDF5.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+#include "G4Event.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include "RMGOutputManagerHDF5Messenger.hh"
+#include "RMGEventInformation.hh"
+#include "RMGLog.hh"
+
+RMGOutputManagerHDF5::SharedFile RMGOutputManagerHDF5::fSharedFile;
+RMGOutputManagerHDF5::ThreadFiles RMGOutputManagerHDF5::fThreadFiles;
+
+namespace {
+
+  // name and units of the datasets, in the same order as the HitColumns
+  struct ColumnInfo {
+    const char* name;
+    const char* units;
+  };
+
+  const ColumnInfo kColumns[] = {
+    {"event_id",  ""},
+    {"volume_id", ""},
+    {"source_id", ""},
+    {"edep",      "keV"},
+    {"x",         "mm"},
+    {"y",         "mm"},
+    {"z",         "mm"},
+    {"t",         "ns"},
+    {"weight",    ""}
+  };
+  const size_t kNColumns = sizeof(kColumns) / sizeof(ColumnInfo);
+
+  // the native types are not compile time constants in HDF5. These are the
+  // types in memory, HDF5 converts them if the datasets have other ones
+  std::vector<hid_t> ColumnTypes() {
+    return {H5T_NATIVE_INT64, H5T_NATIVE_INT32, H5T_NATIVE_INT32, H5T_NATIVE_DOUBLE,
+      H5T_NATIVE_DOUBLE, H5T_NATIVE_DOUBLE, H5T_NATIVE_DOUBLE, H5T_NATIVE_DOUBLE, H5T_NATIVE_DOUBLE};
+  }
+
+  // x, y, z
+  bool IsPositionColumn(size_t i) { return i >= 4 and i <= 6; }
+
+  void WriteStringAttribute(hid_t object, const char* name, const char* value) {
+    auto type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, std::max<size_t>(1, std::strlen(value)));
+    auto space = H5Screate(H5S_SCALAR);
+    auto attr = H5Acreate2(object, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, type, value);
+    H5Aclose(attr);
+    H5Sclose(space);
+    H5Tclose(type);
+  }
+
+  // HDF5 calls from several threads must be serialized, unless the library
+  // is built thread-safe and does it itself
+  std::unique_lock<std::mutex> LockHDF5() {
+    static std::mutex mutex;
+    static const bool threadsafe = [] {
+      hbool_t val = false;
+      H5is_library_threadsafe(&val);
+      return val > 0;
+    }();
+    return threadsafe ? std::unique_lock<std::mutex>() : std::unique_lock<std::mutex>(mutex);
+  }
+
+  hsize_t GetNumberOfRows(hid_t dataset) {
+    hsize_t dims[1] = {0};
+    auto space = H5Dget_space(dataset);
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    H5Sclose(space);
+    return dims[0];
+  }
+
+  // whether the chunks of a dataset can be copied to another one without
+  // decoding them: same type, chunk size and filter pipeline
+  bool HasSameStorage(hid_t src, hid_t dst) {
+
+#if H5_VERSION_GE(1, 10, 2)
+    auto src_type = H5Dget_type(src), dst_type = H5Dget_type(dst);
+    bool same = H5Tequal(src_type, dst_type) > 0;
+    H5Tclose(src_type);
+    H5Tclose(dst_type);
+
+    auto src_dcpl = H5Dget_create_plist(src), dst_dcpl = H5Dget_create_plist(dst);
+    if (same) {
+      hsize_t src_chunk[1] = {0}, dst_chunk[1] = {0};
+      same = H5Pget_layout(src_dcpl) == H5D_CHUNKED and H5Pget_layout(dst_dcpl) == H5D_CHUNKED
+        and H5Pget_chunk(src_dcpl, 1, src_chunk) == 1 and H5Pget_chunk(dst_dcpl, 1, dst_chunk) == 1
+        and src_chunk[0] == dst_chunk[0];
+    }
+    if (same) {
+      auto n_filters = H5Pget_nfilters(src_dcpl);
+      same = n_filters == H5Pget_nfilters(dst_dcpl);
+      for (int i = 0; same and i < n_filters; ++i) {
+        unsigned int src_flags = 0, dst_flags = 0, src_cd[8], dst_cd[8];
+        size_t src_n = 8, dst_n = 8;
+        auto src_id = H5Pget_filter2(src_dcpl, i, &src_flags, &src_n, src_cd, 0, nullptr, nullptr);
+        auto dst_id = H5Pget_filter2(dst_dcpl, i, &dst_flags, &dst_n, dst_cd, 0, nullptr, nullptr);
+        same = src_id == dst_id and src_n == dst_n
+          and std::equal(src_cd, src_cd + std::min<size_t>(src_n, 8), dst_cd);
+      }
+    }
+    H5Pclose(src_dcpl);
+    H5Pclose(dst_dcpl);
+    return same;
+#else
+    // no direct chunk access before HDF5 1.10.2
+    (void)src; (void)dst;
+    return false;
+#endif
+  }
+
+#if H5_VERSION_GE(1, 10, 2)
+  // appends the chunk starting at row src_row of each source dataset to the
+  // destination ones, whose size must be a multiple of the chunk size, as it
+  // is stored: nothing is decompressed nor compressed again
+  void CopyRawChunk(const std::vector<hid_t>& src, hsize_t src_row, const std::vector<hid_t>& dst,
+      hsize_t dst_row, hsize_t chunk_size, std::vector<char>& buffer) {
+
+    hsize_t size[1] = {dst_row + chunk_size};
+    hsize_t src_offset[1] = {src_row}, dst_offset[1] = {dst_row};
+    for (size_t i = 0; i < src.size(); ++i) {
+      H5Dset_extent(dst[i], size);
+      hsize_t n_bytes = 0;
+      std::uint32_t filter_mask = 0;
+      if (H5Dget_chunk_storage_size(src[i], src_offset, &n_bytes) < 0) {
+        RMGLog::Out(RMGLog::fatal, "Could not locate HDF5 chunk at row ", src_row);
+      }
+      buffer.resize(n_bytes);
+      if (H5Dread_chunk(src[i], H5P_DEFAULT, src_offset, &filter_mask, buffer.data()) < 0
+          or H5Dwrite_chunk(dst[i], H5P_DEFAULT, filter_mask, dst_offset, n_bytes, buffer.data()) < 0) {
+        RMGLog::Out(RMGLog::fatal, "Could not copy HDF5 chunk at row ", src_row);
+      }
+    }
+  }
+#endif
+
+  template <typename T>
+  void MoveTailTo(std::vector<T>& src, size_t n, std::vector<T>& dst) {
+    dst.insert(dst.end(), src.begin() + n, src.end());
+    src.resize(n);
+  }
+
+  // spatial hash of the clustering cells
+  inline size_t HashClusterCell(std::int32_t volume_id, std::int32_t ix, std::int32_t iy, std::int32_t iz) {
+    std::uint64_t h = static_cast<std::uint32_t>(volume_id);
+    h = h * 0x9e3779b97f4a7c15ULL + static_cast<std::uint32_t>(ix);
+    h = h * 0x9e3779b97f4a7c15ULL + static_cast<std::uint32_t>(iy);
+    h = h * 0x9e3779b97f4a7c15ULL + static_cast<std::uint32_t>(iz);
+    return h ^ (h >> 29);
+  }
+}
+
+void RMGOutputManagerHDF5::HitColumns::Reserve(size_t n) {
+  event_id.reserve(n); volume_id.reserve(n); source_id.reserve(n);
+  edep.reserve(n); x.reserve(n); y.reserve(n); z.reserve(n); t.reserve(n); weight.reserve(n);
+}
+
+void RMGOutputManagerHDF5::HitColumns::Resize(size_t n) {
+  event_id.resize(n); volume_id.resize(n); source_id.resize(n);
+  edep.resize(n); x.resize(n); y.resize(n); z.resize(n); t.resize(n); weight.resize(n);
+}
+
+void RMGOutputManagerHDF5::HitColumns::Clear() {
+  event_id.clear(); volume_id.clear(); source_id.clear();
+  edep.clear(); x.clear(); y.clear(); z.clear(); t.clear(); weight.clear();
+}
+
+void RMGOutputManagerHDF5::HitColumns::MoveTail(size_t n, HitColumns& dst) {
+  MoveTailTo(event_id, n, dst.event_id); MoveTailTo(volume_id, n, dst.volume_id);
+  MoveTailTo(source_id, n, dst.source_id); MoveTailTo(edep, n, dst.edep);
+  MoveTailTo(x, n, dst.x); MoveTailTo(y, n, dst.y); MoveTailTo(z, n, dst.z);
+  MoveTailTo(t, n, dst.t); MoveTailTo(weight, n, dst.weight);
+}
+
+RMGOutputManagerHDF5::RMGOutputManagerHDF5() :
+  fChunkSize(65536),
+  fCompressionLevel(4),
+  fQueueSize(16),
+  fPerThreadFiles(false),
+  fFloatPositions(false),
+  fClusterHits(false),
+  fClusterDistance(0.1),
+  fClusterTime(1000),
+  fNSteps(0),
+  fNWrittenHits(0),
+  fEventIDOffset(0),
+  fEventID(0),
+  fSourceID(-1),
+  fEventWeight(1),
+  fThreadFile(-1) {
+
+  fFileName = "remage-output.hdf5";
+  fG4Messenger = std::unique_ptr<RMGOutputManagerHDF5Messenger>(new RMGOutputManagerHDF5Messenger(this));
+
+  RMGVOutputManager::RegisterEndOfMasterRunAction("HDF5", &RMGOutputManagerHDF5::EndOfMasterRunAction);
+}
+
+RMGOutputManagerHDF5::~RMGOutputManagerHDF5() = default;
+
+void RMGOutputManagerHDF5::BuildVolumeIDs() {
+
+  fVolumeIDs.clear();
+  auto store = G4PhysicalVolumeStore::GetInstance();
+  for (size_t i = 0; i < store->size(); ++i) {
+    auto pv = (*store)[i];
+    if (fSensitiveVolumes.empty() or fSensitiveVolumes.count(pv->GetName())) {
+      fVolumeIDs.emplace(pv, static_cast<std::int32_t>(i));
+    }
+  }
+  if (fVolumeIDs.empty()) RMGLog::Out(RMGLog::warning, "No sensitive volume found, no hits will be recorded");
+}
+
+void RMGOutputManagerHDF5::BeginOfRunAction() {
+  this->BuildVolumeIDs();
+  fHits.Reserve(2 * fChunkSize);
+  fNSteps = 0;
+  fNWrittenHits = 0;
+  this->OpenFile();
+}
+
+void RMGOutputManagerHDF5::EndOfRunAction() {
+
+  if (fClusterHits and fNWrittenHits > 0) {
+    RMGLog::OutFormat(RMGLog::detail, "Clustering: %ld steps merged into %ld hits (factor %.1f)",
+        fNSteps, fNWrittenHits, static_cast<double>(fNSteps) / fNWrittenHits);
+  }
+  this->WriteFile();
+  this->CloseFile();
+}
+
+void RMGOutputManagerHDF5::BeginOfEventAction(const G4Event* event) {
+
+  fEventID = event->GetEventID() + fEventIDOffset;
+  fEventWeight = RMGVOutputManager::GetEventWeight(event);
+  auto info = dynamic_cast<const RMGEventInformation*>(event->GetUserInformation());
+  fSourceID = info ? info->GetSourceID() : -1;
+}
+
+void RMGOutputManagerHDF5::PrepareNewEvent(const G4Event*) {
+  fEventHits.clear();
+}
+
+void RMGOutputManagerHDF5::EndOfEventAction(const G4Event*) {
+
+  if (fClusterHits) {
+    this->ClusterEventHits();
+    for (const auto& hit : fClusters) this->AppendHit(hit);
+    fNSteps += fEventHits.size();
+    fNWrittenHits += fClusters.size();
+  }
+  else {
+    for (const auto& hit : fEventHits) this->AppendHit(hit);
+  }
+
+  // only whole chunks are written during the run
+  if (fHits.size() >= fChunkSize) this->Submit(fHits.size() / fChunkSize * fChunkSize);
+}
+
+void RMGOutputManagerHDF5::SteppingAction(const G4Step* step, G4SteppingManager*) {
+
+  auto edep = step->GetTotalEnergyDeposit();
+  if (edep <= 0) return;
+
+  auto pre = step->GetPreStepPoint();
+  auto it = fVolumeIDs.find(pre->GetPhysicalVolume());
+  if (it == fVolumeIDs.end()) return;
+
+  // the energy is deposited along the step
+  auto post = step->GetPostStepPoint();
+  auto pos = 0.5 * (pre->GetPosition() + post->GetPosition());
+
+  fEventHits.push_back({it->second,
+      static_cast<G4float>(pos.x() / CLHEP::mm),
+      static_cast<G4float>(pos.y() / CLHEP::mm),
+      static_cast<G4float>(pos.z() / CLHEP::mm),
+      edep / CLHEP::keV,
+      post->GetGlobalTime() / CLHEP::ns});
+}
+
+constexpr std::uint32_t RMGOutputManagerHDF5::kNoCluster;
+
+RMGOutputManagerHDF5::ClusterCell RMGOutputManagerHDF5::GetClusterCell(const HitRecord& hit) const {
+
+  // cells of the distance radius: a cluster within the radius of a step is
+  // in one of the 27 cells around it. Clamping keeps neighbours neighbours
+  auto size = fClusterDistance > 0 ? fClusterDistance : 1.;
+  auto index = [size](G4float x) {
+    auto i = std::floor(x / size);
+    return static_cast<std::int32_t>(std::max(-2e9, std::min(2e9, i)));
+  };
+  return ClusterCell{hit.volume_id, index(hit.x), index(hit.y), index(hit.z)};
+}
+
+void RMGOutputManagerHDF5::AddToClusterTable(const ClusterCell& cell, std::uint32_t cluster) {
+  auto mask = fClusterTable.size() - 1;
+  auto i = HashClusterCell(cell.volume_id, cell.ix, cell.iy, cell.iz) & mask;
+  while (fClusterTable[i].cluster != kNoCluster) i = (i + 1) & mask;
+  fClusterTable[i] = ClusterTableEntry{cell, cluster};
+}
+
+void RMGOutputManagerHDF5::ClusterEventHits() {
+
+  fClusters.clear();
+  fClusterCells.clear();
+  if (fEventHits.empty()) return;
+
+  // each step adds at most one entry, keep the table at most half full. The
+  // vectors are reused from event to event
+  size_t table_size = 16;
+  while (table_size < 2 * fEventHits.size()) table_size *= 2;
+  fClusterTable.assign(table_size, ClusterTableEntry{ClusterCell{0, 0, 0, 0}, kNoCluster});
+  auto mask = table_size - 1;
+
+  auto max_dist2 = fClusterDistance * fClusterDistance;
+  for (const auto& hit : fEventHits) {
+    auto cell = this->GetClusterCell(hit);
+
+    // the latest matching cluster, the most likely one as consecutive steps
+    // mostly belong to the same track
+    auto best = kNoCluster;
+    for (int dx = -1; dx <= 1; ++dx) {
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dz = -1; dz <= 1; ++dz) {
+          ClusterCell around{cell.volume_id, cell.ix + dx, cell.iy + dy, cell.iz + dz};
+          auto i = HashClusterCell(around.volume_id, around.ix, around.iy, around.iz) & mask;
+          for (; fClusterTable[i].cluster != kNoCluster; i = (i + 1) & mask) {
+            const auto& entry = fClusterTable[i];
+            if (!(entry.cell == around) or !(fClusterCells[entry.cluster] == around)) continue;
+            if (best != kNoCluster and entry.cluster <= best) continue;
+
+            const auto& c = fClusters[entry.cluster];
+            if (std::abs(hit.t - c.t) > fClusterTime) continue;
+            auto ddx = hit.x - c.x, ddy = hit.y - c.y, ddz = hit.z - c.z;
+            if (ddx*ddx + ddy*ddy + ddz*ddz > max_dist2) continue;
+            best = entry.cluster;
+          }
+        }
+      }
+    }
+
+    if (best == kNoCluster) {
+      fClusters.push_back(hit);
+      fClusterCells.push_back(cell);
+      this->AddToClusterTable(cell, fClusters.size() - 1);
+      continue;
+    }
+
+    auto& c = fClusters[best];
+    auto edep = c.edep + hit.edep;
+    c.x = (c.x * c.edep + hit.x * hit.edep) / edep;
+    c.y = (c.y * c.edep + hit.y * hit.edep) / edep;
+    c.z = (c.z * c.edep + hit.z * hit.edep) / edep;
+    c.t = std::min(c.t, hit.t);
+    c.edep = edep;
+
+    auto new_cell = this->GetClusterCell(c);
+    if (!(new_cell == fClusterCells[best])) {
+      fClusterCells[best] = new_cell;
+      this->AddToClusterTable(new_cell, best);
+    }
+  }
+}
+
+void RMGOutputManagerHDF5::OpenFile() {
+
+  // event ids restart from zero in each run
+  {
+    std::lock_guard<std::mutex> lock(fSharedFile.mutex);
+    fSharedFile.run_file = fFileName;
+    fEventIDOffset = fSharedFile.n_events[fFileName];
+  }
+
+  // without worker threads there is nothing to merge
+  if (fPerThreadFiles and G4Threading::IsWorkerThread()) {
+    this->OpenThreadFile();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(fSharedFile.mutex);
+
+  fSharedFile.n_users++;
+  if (fSharedFile.file >= 0) return;
+
+  if (fFileName.empty()) RMGLog::Out(RMGLog::fatal, "No output file name specified");
+
+  // later runs append to the file created by the first one
+  if (fSharedFile.created.count(fFileName)) {
+    fSharedFile.file = H5Fopen(fFileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    if (fSharedFile.file < 0) RMGLog::Out(RMGLog::fatal, "Could not reopen output file '", fFileName, "'");
+    fSharedFile.datasets = OpenDatasets(fSharedFile.file);
+  }
+  else {
+    fSharedFile.file = H5Fcreate(fFileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (fSharedFile.file < 0) RMGLog::Out(RMGLog::fatal, "Could not create output file '", fFileName, "'");
+    fSharedFile.created.insert(fFileName);
+
+    this->DefineSchema();
+    this->SetSchemaDefined(true);
+
+    RMGLog::Out(RMGLog::summary, "Writing hits to HDF5 file '", fFileName, "'");
+  }
+
+  fSharedFile.queue = std::unique_ptr<RMGMPMCQueue<Buffer>>(new RMGMPMCQueue<Buffer>(fQueueSize));
+  fSharedFile.free_buffers = std::unique_ptr<RMGMPMCQueue<Buffer>>(new RMGMPMCQueue<Buffer>(fQueueSize));
+  fSharedFile.n_buffers = 0;
+  fSharedFile.n_stalls = 0;
+  fSharedFile.stall_time_us = 0;
+  fSharedFile.depth = 0;
+  fSharedFile.max_depth = 0;
+  fSharedFile.stop = false;
+  fSharedFile.writer = std::thread(&RMGOutputManagerHDF5::WriterLoop);
+}
+
+void RMGOutputManagerHDF5::OpenThreadFile() {
+
+  if (fFileName.empty()) RMGLog::Out(RMGLog::fatal, "No output file name specified");
+
+  // output.hdf5 -> output-t<thread id>.hdf5
+  auto dot = fFileName.find_last_of('.');
+  auto slash = fFileName.find_last_of('/');
+  if (dot == std::string::npos or (slash != std::string::npos and dot < slash)) dot = fFileName.size();
+  fThreadFileName = fFileName.substr(0, dot) + "-t" + std::to_string(G4Threading::G4GetThreadId())
+    + fFileName.substr(dot);
+
+  auto lock = LockHDF5();
+  fThreadFile = H5Fcreate(fThreadFileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (fThreadFile < 0) RMGLog::Out(RMGLog::fatal, "Could not create output file '", fThreadFileName, "'");
+
+  this->DefineSchema();
+  this->SetSchemaDefined(true);
+
+  RMGLog::Out(RMGLog::detail, "Writing hits of this thread to HDF5 file '", fThreadFileName, "'");
+}
+
+void RMGOutputManagerHDF5::DefineSchema() {
+
+  // called with the file just created
+  if (fThreadFile >= 0) {
+    fThreadDatasets = CreateLayout(fThreadFile, fChunkSize, fCompressionLevel, fFloatPositions);
+  }
+  else fSharedFile.datasets = CreateLayout(fSharedFile.file, fChunkSize, fCompressionLevel, fFloatPositions);
+}
+
+std::vector<hid_t> RMGOutputManagerHDF5::CreateLayout(hid_t file, size_t chunk_size,
+    G4int compression_level, G4bool float_positions) {
+
+  std::vector<hid_t> datasets;
+
+  // chunks as large as the buffers, each flush writes whole chunks
+  hsize_t dims[1] = {0};
+  hsize_t max_dims[1] = {H5S_UNLIMITED};
+  hsize_t chunk_dims[1] = {std::max<hsize_t>(1, chunk_size)};
+
+  auto space = H5Screate_simple(1, dims, max_dims);
+  auto dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dcpl, 1, chunk_dims);
+  if (compression_level > 0) {
+    H5Pset_shuffle(dcpl);
+    H5Pset_deflate(dcpl, compression_level);
+  }
+
+  auto group = H5Gcreate2(file, "/hits", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  auto types = ColumnTypes();
+  if (float_positions) {
+    for (size_t i = 0; i < kNColumns; ++i) if (IsPositionColumn(i)) types[i] = H5T_NATIVE_FLOAT;
+  }
+  for (size_t i = 0; i < kNColumns; ++i) {
+    auto ds = H5Dcreate2(group, kColumns[i].name, types[i], space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    if (ds < 0) RMGLog::Out(RMGLog::fatal, "Could not create dataset '", kColumns[i].name, "'");
+    if (std::strlen(kColumns[i].units) > 0) WriteStringAttribute(ds, "units", kColumns[i].units);
+    datasets.push_back(ds);
+  }
+  H5Gclose(group);
+  H5Pclose(dcpl);
+  H5Sclose(space);
+
+  // names of the volumes, the volume id is the index in this table
+  auto store = G4PhysicalVolumeStore::GetInstance();
+  size_t max_length = 1;
+  for (const auto& pv : *store) max_length = std::max<size_t>(max_length, pv->GetName().size());
+  std::vector<char> names(store->size() * max_length, '\0');
+  for (size_t i = 0; i < store->size(); ++i) {
+    const auto& name = (*store)[i]->GetName();
+    std::copy(name.begin(), name.end(), names.begin() + i * max_length);
+  }
+
+  hsize_t n_volumes[1] = {store->size()};
+  auto str_type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(str_type, max_length);
+  H5Tset_strpad(str_type, H5T_STR_NULLPAD);
+  auto vol_space = H5Screate_simple(1, n_volumes, nullptr);
+  auto vol_group = H5Gcreate2(file, "/volumes", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  auto vol_ds = H5Dcreate2(vol_group, "name", str_type, vol_space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (!names.empty()) H5Dwrite(vol_ds, str_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, names.data());
+  H5Dclose(vol_ds);
+  H5Gclose(vol_group);
+  H5Sclose(vol_space);
+  H5Tclose(str_type);
+
+  return datasets;
+}
+
+std::vector<hid_t> RMGOutputManagerHDF5::OpenDatasets(hid_t file) {
+
+  std::vector<hid_t> datasets;
+  for (size_t i = 0; i < kNColumns; ++i) {
+    auto ds = H5Dopen2(file, (G4String("/hits/") + kColumns[i].name).c_str(), H5P_DEFAULT);
+    if (ds < 0) RMGLog::Out(RMGLog::fatal, "Could not open dataset '", kColumns[i].name, "'");
+    datasets.push_back(ds);
+  }
+  return datasets;
+}
+
+void RMGOutputManagerHDF5::Submit(size_t n) {
+
+  n = std::min(n, fHits.size());
+  if (n == 0) return;
+
+  if (fThreadFile >= 0) {
+    // nobody else writes to this file, no need for the writer thread
+    {
+      auto lock = LockHDF5();
+      AppendColumns(fThreadDatasets, fHits, n);
+    }
+    fSpareHits.Clear();
+    fHits.MoveTail(n, fSpareHits);
+    std::swap(fHits, fSpareHits);
+    return;
+  }
+
+  // the filled buffer is handed over as a whole and replaced by one already
+  // written, rows beyond n are moved back
+  Buffer record;
+  if (!fSharedFile.free_buffers->TryPop(record)) {
+    record = Buffer(new HitColumns());
+    record->Reserve(2 * fChunkSize);
+  }
+  std::swap(*record, fHits);
+  record->MoveTail(n, fHits);
+
+  // counted before the push, the writer may pop the buffer right away
+  auto depth = ++fSharedFile.depth;
+  auto max_depth = fSharedFile.max_depth.load();
+  while (depth > max_depth and !fSharedFile.max_depth.compare_exchange_weak(max_depth, depth)) {}
+
+  if (!fSharedFile.queue->TryPush(std::move(record))) {
+    // the writer cannot keep up, wait for it
+    fSharedFile.n_stalls++;
+    auto start = std::chrono::steady_clock::now();
+    while (!fSharedFile.queue->TryPush(std::move(record))) std::this_thread::yield();
+    fSharedFile.stall_time_us += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+
+  // taking the lock orders this wake-up after the writer checked the depth,
+  // it cannot be lost. Once per buffer, i.e. per chunk
+  { std::lock_guard<std::mutex> lock(fSharedFile.wake_mutex); }
+  fSharedFile.wake.notify_one();
+}
+
+void RMGOutputManagerHDF5::WriterLoop() {
+
+  Buffer record;
+  while (true) {
+    // everything submitted before the stop request is still written
+    auto stopping = fSharedFile.stop.load();
+    if (fSharedFile.queue->TryPop(record)) {
+      fSharedFile.depth--;
+      AppendColumns(fSharedFile.datasets, *record, record->size());
+      fSharedFile.n_buffers++;
+      record->Clear();
+      // if there are already enough spare buffers, this one is dropped
+      if (!fSharedFile.free_buffers->TryPush(std::move(record))) record.reset();
+      continue;
+    }
+    if (stopping) break;
+
+    // sleep until a buffer is submitted or the file is closed. The depth is
+    // counted before the push, a buffer may be on its way: then TryPop() is
+    // retried right away
+    std::unique_lock<std::mutex> lock(fSharedFile.wake_mutex);
+    fSharedFile.wake.wait(lock, [] { return fSharedFile.depth > 0 or fSharedFile.stop; });
+  }
+}
+
+void RMGOutputManagerHDF5::AppendColumns(const std::vector<hid_t>& datasets, const HitColumns& hits,
+    size_t n) {
+
+  // all the columns have the same length
+  auto offset = GetNumberOfRows(datasets[0]);
+  hsize_t size[1] = {offset + n};
+  for (auto ds : datasets) H5Dset_extent(ds, size);
+  WriteColumns(datasets, hits, n, offset);
+}
+
+void RMGOutputManagerHDF5::WriteColumns(const std::vector<hid_t>& datasets, const HitColumns& hits,
+    size_t n, hsize_t offset) {
+
+  const void* data[] = {hits.event_id.data(), hits.volume_id.data(), hits.source_id.data(),
+    hits.edep.data(), hits.x.data(), hits.y.data(), hits.z.data(), hits.t.data(),
+    hits.weight.data()};
+  auto types = ColumnTypes();
+
+  hsize_t start[1] = {offset}, count[1] = {n};
+  auto mem_space = H5Screate_simple(1, count, nullptr);
+  for (size_t i = 0; i < kNColumns; ++i) {
+    auto file_space = H5Dget_space(datasets[i]);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+    if (H5Dwrite(datasets[i], types[i], mem_space, file_space, H5P_DEFAULT, data[i]) < 0) {
+      RMGLog::Out(RMGLog::fatal, "Could not write HDF5 column '", kColumns[i].name, "'");
+    }
+    H5Sclose(file_space);
+  }
+  H5Sclose(mem_space);
+}
+
+void RMGOutputManagerHDF5::ReadColumns(const std::vector<hid_t>& datasets, hsize_t offset, size_t n,
+    HitColumns& hits) {
+
+  hits.Resize(n);
+  void* data[] = {hits.event_id.data(), hits.volume_id.data(), hits.source_id.data(),
+    hits.edep.data(), hits.x.data(), hits.y.data(), hits.z.data(), hits.t.data(),
+    hits.weight.data()};
+  auto types = ColumnTypes();
+
+  hsize_t start[1] = {offset}, count[1] = {n};
+  auto mem_space = H5Screate_simple(1, count, nullptr);
+  for (size_t i = 0; i < kNColumns; ++i) {
+    auto file_space = H5Dget_space(datasets[i]);
+    H5Sselect_hyperslab(file_space, H5S_SELECT_SET, start, nullptr, count, nullptr);
+    if (H5Dread(datasets[i], types[i], mem_space, file_space, H5P_DEFAULT, data[i]) < 0) {
+      RMGLog::Out(RMGLog::fatal, "Could not read HDF5 column '", kColumns[i].name, "'");
+    }
+    H5Sclose(file_space);
+  }
+  H5Sclose(mem_space);
+}
+
+void RMGOutputManagerHDF5::WriteFile() {
+  this->Submit(fHits.size());
+}
+
+void RMGOutputManagerHDF5::CloseFile() {
+
+  if (fThreadFile >= 0) {
+    this->CloseThreadFile();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(fSharedFile.mutex);
+
+  if (fSharedFile.n_users == 0 or --fSharedFile.n_users > 0) return;
+  if (fSharedFile.file < 0) return;
+
+  // all the users are done, let the writer drain the queue
+  {
+    std::lock_guard<std::mutex> wake_lock(fSharedFile.wake_mutex);
+    fSharedFile.stop = true;
+  }
+  fSharedFile.wake.notify_one();
+  fSharedFile.writer.join();
+  auto capacity = fSharedFile.queue->GetCapacity();
+  fSharedFile.queue.reset();
+  fSharedFile.free_buffers.reset();
+
+  RMGLog::OutFormat(RMGLog::summary, "HDF5 output: %ld buffers written, workers stalled %ld times "
+      "on a full queue (%.3f s in total), at most %ld buffers pending (queue size %zu)", fSharedFile.n_buffers.load(),
+      fSharedFile.n_stalls.load(), fSharedFile.stall_time_us.load() * 1e-6,
+      fSharedFile.max_depth.load(), capacity);
+
+  for (auto& ds : fSharedFile.datasets) H5Dclose(ds);
+  fSharedFile.datasets.clear();
+  H5Fclose(fSharedFile.file);
+  fSharedFile.file = -1;
+
+  RMGLog::Out(RMGLog::detail, "HDF5 output file '", fFileName, "' closed");
+}
+
+void RMGOutputManagerHDF5::CloseThreadFile() {
+
+  {
+    auto lock = LockHDF5();
+    for (auto& ds : fThreadDatasets) H5Dclose(ds);
+    fThreadDatasets.clear();
+    H5Fclose(fThreadFile);
+    fThreadFile = -1;
+  }
+
+  std::lock_guard<std::mutex> lock(fThreadFiles.mutex);
+  fThreadFiles.target = fFileName;
+  fThreadFiles.chunk_size = std::max<size_t>(1, fChunkSize);
+  fThreadFiles.compression_level = fCompressionLevel;
+  fThreadFiles.float_positions = fFloatPositions;
+  fThreadFiles.files.emplace_back(G4Threading::G4GetThreadId(), fThreadFileName);
+}
+
+void RMGOutputManagerHDF5::EndOfMasterRunAction(std::int64_t n_events) {
+
+  {
+    std::lock_guard<std::mutex> lock(fSharedFile.mutex);
+    if (!fSharedFile.run_file.empty()) fSharedFile.n_events[fSharedFile.run_file] += n_events;
+    fSharedFile.run_file.clear();
+  }
+  MergeThreadFiles();
+}
+
+void RMGOutputManagerHDF5::MergeThreadFiles() {
+
+  std::lock_guard<std::mutex> lock(fThreadFiles.mutex);
+  if (fThreadFiles.files.empty()) return;
+
+  // in thread order, for reproducible files
+  auto files = std::move(fThreadFiles.files);
+  fThreadFiles.files.clear();
+  std::sort(files.begin(), files.end());
+  const auto& target = fThreadFiles.target;
+  auto chunk_size = fThreadFiles.chunk_size;
+
+  // the workers are done, only the master touches the HDF5 library now
+  hid_t file = -1;
+  std::vector<hid_t> datasets;
+  {
+    std::lock_guard<std::mutex> shared_lock(fSharedFile.mutex);
+    if (fSharedFile.created.count(target)) {
+      file = H5Fopen(target.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+      if (file < 0) RMGLog::Out(RMGLog::fatal, "Could not reopen output file '", target, "'");
+      datasets = OpenDatasets(file);
+    }
+    else {
+      file = H5Fcreate(target.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+      if (file < 0) RMGLog::Out(RMGLog::fatal, "Could not create output file '", target, "'");
+      fSharedFile.created.insert(target);
+      datasets = CreateLayout(file, chunk_size, fThreadFiles.compression_level, fThreadFiles.float_positions);
+    }
+  }
+
+  // rows are appended in whole chunks of the output file, such that no
+  // chunk is compressed twice. Full chunks of the thread files are copied as
+  // they are stored if the layouts match, the others are decoded and carried
+  // over until they fill a chunk
+  auto written = GetNumberOfRows(datasets[0]);
+  hsize_t n_merged = 0;
+  size_t n_raw_chunks = 0;
+  HitColumns block, pending, spare;
+  std::vector<char> raw_buffer;
+  auto flush = [&](bool all) {
+    size_t n = pending.size();
+    if (!all) {
+      size_t to_boundary = (chunk_size - written % chunk_size) % chunk_size;
+      n = n < to_boundary ? 0 : to_boundary + (n - to_boundary) / chunk_size * chunk_size;
+    }
+    if (n == 0) return;
+    AppendColumns(datasets, pending, n);
+    written += n;
+    spare.Clear();
+    pending.MoveTail(n, spare);
+    std::swap(pending, spare);
+  };
+  auto decode = [&](const std::vector<hid_t>& src, hsize_t row, hsize_t n) {
+    ReadColumns(src, row, n, block);
+    block.MoveTail(0, pending);
+    flush(false);
+  };
+
+  struct ThreadFile {
+    hid_t              file;
+    std::vector<hid_t> datasets;
+    hsize_t            n_rows;
+    G4bool             raw;
+  };
+  std::vector<ThreadFile> thread_files;
+  for (const auto& f : files) {
+    ThreadFile tf;
+    tf.file = H5Fopen(f.second.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (tf.file < 0) RMGLog::Out(RMGLog::fatal, "Could not open thread output file '", f.second, "'");
+    tf.datasets = OpenDatasets(tf.file);
+    tf.n_rows = GetNumberOfRows(tf.datasets[0]);
+    tf.raw = true;
+    for (size_t i = 0; i < kNColumns; ++i) tf.raw = tf.raw and HasSameStorage(tf.datasets[i], datasets[i]);
+    n_merged += tf.n_rows;
+    thread_files.push_back(std::move(tf));
+  }
+
+  // the incomplete last chunks go first, they fill the last chunk of the
+  // output file if it is not complete, such that the full chunks that follow
+  // are aligned to it. As with the shared file, the hits of an event
+  // crossing a chunk boundary may end up in two places: they are grouped by
+  // event id, not by position in the file
+  for (const auto& tf : thread_files) {
+    auto tail = tf.n_rows % chunk_size;
+    if (tail > 0) decode(tf.datasets, tf.n_rows - tail, tail);
+  }
+  for (const auto& tf : thread_files) {
+    for (hsize_t row = 0; row + chunk_size <= tf.n_rows; row += chunk_size) {
+#if H5_VERSION_GE(1, 10, 2)
+      if (tf.raw and written % chunk_size == 0) {
+        CopyRawChunk(tf.datasets, row, datasets, written, chunk_size, raw_buffer);
+        written += chunk_size;
+        n_raw_chunks++;
+        continue;
+      }
+#endif
+      decode(tf.datasets, row, chunk_size);
+    }
+  }
+  flush(true);
+
+  for (size_t k = 0; k < files.size(); ++k) {
+    for (auto ds : thread_files[k].datasets) H5Dclose(ds);
+    H5Fclose(thread_files[k].file);
+    if (std::remove(files[k].second.c_str()) != 0) {
+      RMGLog::Out(RMGLog::warning, "Could not remove thread output file '", files[k].second, "'");
+    }
+  }
+
+  for (auto ds : datasets) H5Dclose(ds);
+  H5Fclose(file);
+
+  RMGLog::Out(RMGLog::summary, "Merged ", files.size(), " thread output files (",
+      n_merged, " hits) into '", target, "', ", n_raw_chunks, " chunks copied without recompression");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,89 @@
+#include "RMGOutputManagerHDF5Messenger.hh"
+
+#include "RMGOutputManagerHDF5.hh"
+#include "RMGTools.hh"
+#include "RMGLog.hh"
+
+RMGOutputManagerHDF5Messenger::RMGOutputManagerHDF5Messenger(RMGOutputManagerHDF5* manager) :
+  fOutputManager(manager) {
+
+  G4String directory = "/RMG/Output/HDF5";
+  fDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
+
+  // the layout of the datasets is fixed when the file is created
+  fChunkSizeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(directory + "/ChunkSize",
+      this, "N", "N > 0", {G4State_PreInit, G4State_Idle});
+  fChunkSizeCmd->SetGuidance("Number of hits buffered per thread and written as one HDF5 chunk");
+
+  fCompressionLevelCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(directory + "/CompressionLevel",
+      this, "level", "level >= 0 && level <= 9", {G4State_PreInit, G4State_Idle});
+  fCompressionLevelCmd->SetGuidance("Deflate compression level, 0 disables compression");
+
+  fQueueSizeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(directory + "/QueueSize",
+      this, "N", "N > 0", {G4State_PreInit, G4State_Idle});
+  fQueueSizeCmd->SetGuidance("Maximum number of full buffers waiting for the writer thread, "
+      "workers wait if it is reached");
+
+  fPerThreadFilesCmd = RMGTools::MakeG4UIcmdWithABool(directory + "/PerThreadFiles", this, false,
+      {G4State_PreInit, G4State_Idle});
+  fPerThreadFilesCmd->SetGuidance("Each worker thread writes its own file, merged into the output "
+      "file at the end of the run");
+
+  fFloatPositionsCmd = RMGTools::MakeG4UIcmdWithABool(directory + "/FloatPositions", this, false,
+      {G4State_PreInit, G4State_Idle});
+  fFloatPositionsCmd->SetGuidance("Store the hit positions as single precision floats");
+
+  G4String cluster_directory = directory + "/Clustering";
+  fClusteringDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(cluster_directory));
+  fClusteringDirectory->SetGuidance("Merge the steps of an event that are close in space and time");
+
+  fClusterHitsCmd = RMGTools::MakeG4UIcmdWithABool(cluster_directory + "/Enable", this, false,
+      {G4State_PreInit, G4State_Idle});
+  fClusterHitsCmd->SetGuidance("Write clusters of steps in the same volume instead of single steps");
+
+  fClusterDistanceCmd = RMGTools::MakeG4UIcmdWithANumberAndUnit<G4UIcmdWithADoubleAndUnit>(
+      cluster_directory + "/DistanceRadius", this, "Length", "", "R", "R > 0", {G4State_PreInit, G4State_Idle});
+  fClusterDistanceCmd->SetGuidance("Maximum distance of a step from the position of its cluster");
+
+  fClusterTimeCmd = RMGTools::MakeG4UIcmdWithANumberAndUnit<G4UIcmdWithADoubleAndUnit>(
+      cluster_directory + "/TimeRadius", this, "Time", "", "T", "T > 0", {G4State_PreInit, G4State_Idle});
+  fClusterTimeCmd->SetGuidance("Maximum time difference of a step from its cluster");
+
+  fAddSensitiveVolumeCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/AddSensitiveVolume", this, "",
+      {G4State_PreInit, G4State_Idle});
+  fAddSensitiveVolumeCmd->SetGuidance("Record hits only in the given physical volumes (all if none is given)");
+}
+
+void RMGOutputManagerHDF5Messenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
+
+  if (cmd == fChunkSizeCmd.get()) {
+    fOutputManager->SetChunkSize(fChunkSizeCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fCompressionLevelCmd.get()) {
+    fOutputManager->SetCompressionLevel(fCompressionLevelCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fQueueSizeCmd.get()) {
+    fOutputManager->SetQueueSize(fQueueSizeCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fPerThreadFilesCmd.get()) {
+    fOutputManager->SetPerThreadFiles(fPerThreadFilesCmd->GetNewBoolValue(new_values));
+  }
+  else if (cmd == fFloatPositionsCmd.get()) {
+    fOutputManager->SetFloatPositions(fFloatPositionsCmd->GetNewBoolValue(new_values));
+  }
+  else if (cmd == fClusterHitsCmd.get()) {
+    fOutputManager->SetClusterHits(fClusterHitsCmd->GetNewBoolValue(new_values));
+  }
+  else if (cmd == fClusterDistanceCmd.get()) {
+    fOutputManager->SetClusterDistance(fClusterDistanceCmd->GetNewDoubleValue(new_values));
+  }
+  else if (cmd == fClusterTimeCmd.get()) {
+    fOutputManager->SetClusterTime(fClusterTimeCmd->GetNewDoubleValue(new_values));
+  }
+  else if (cmd == fAddSensitiveVolumeCmd.get()) {
+    fOutputManager->AddSensitiveVolume(new_values);
+  }
+  else RMGLog::Out(RMGLog::error, "Command ", cmd->GetTitle(), " not known");
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,10 +1,19 @@
+#include "RMGVOutputManager.hh"
+
+#include <map>
+
 #include "G4GenericIon.hh"
 #include "G4EventManager.hh"
+#include "G4StackManager.hh"
 #include "G4RunManager.hh"
-#include "RMGVOutputManager.hh"
-#include "RMGLog.hh"
+#include "G4Track.hh"
+#include "G4ParticleTable.hh"
+#include "G4ProcessManager.hh"
+#include "G4VProcess.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4AutoLock.hh"
 
-G4String RMGVOutputManager::fFileName = "";
+#include "RMGLog.hh"
 
 RMGVOutputManager::RMGVOutputManager():
   fUseTimeWindow(false),
@@ -12,12 +21,44 @@ RMGVOutputManager::RMGVOutputManager():
   fOffsetTime(0 * CLHEP::second),
   fTempOffsetTime(0 * CLHEP::second),
   fHasRadDecay(true),
+  fRadDecayProcPointer(nullptr),
   fInNewStage(false),
   fOnFirstTrack(false),
   fUseImportanceSamplingWindow(false),
   fSchemaDefined(false),
   fWaveformsSaved(false) {}
 
+// by default output managers do nothing, they override what they need
+void RMGVOutputManager::BeginOfEventAction(const G4Event*) {}
+void RMGVOutputManager::BeginOfRunAction() {}
+void RMGVOutputManager::EndOfEventAction(const G4Event*) {}
+void RMGVOutputManager::EndOfRunAction() {}
+void RMGVOutputManager::SteppingAction(const G4Step*, G4SteppingManager*) {}
+void RMGVOutputManager::PrepareNewEvent(const G4Event*) {}
+void RMGVOutputManager::ResetPartialEvent(const G4Event*) {}
+void RMGVOutputManager::PreUserTrackingAction(const G4Track*) {}
+void RMGVOutputManager::PostUserTrackingAction(const G4Track*) {}
+void RMGVOutputManager::WriteFile() {}
+
+namespace {
+  G4Mutex gMasterRunActionsMutex = G4MUTEX_INITIALIZER;
+  std::map<G4String, RMGVOutputManager::MasterRunAction>& GetMasterRunActions() {
+    static std::map<G4String, RMGVOutputManager::MasterRunAction> actions;
+    return actions;
+  }
+}
+
+void RMGVOutputManager::RegisterEndOfMasterRunAction(const G4String& name, MasterRunAction action) {
+  G4AutoLock lock(&gMasterRunActionsMutex);
+  GetMasterRunActions()[name] = std::move(action);
+}
+
+void RMGVOutputManager::EndOfMasterRunAction(G4int n_events) {
+  // the workers are done, nobody registers anything anymore
+  G4AutoLock lock(&gMasterRunActionsMutex);
+  for (const auto& action : GetMasterRunActions()) action.second(n_events);
+}
+
 /* This method returns true if the track is time windowed and false otherwise.
  * If fUseTimeWindow is true, then will check and see if RadioactiveDecay is a
  * valid process (first time called only), and then compare RD process pointer
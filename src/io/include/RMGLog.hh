@@ -181,6 +181,10 @@ class RMGLog {
     template <RMGLog::Ansi color, typename T>
     static std::string Colorize(const T& msg, std::ostream& os, bool bold=false);
 
+    /**
+     * Common implementation of the OutFormat() overloads */
+    static void OutFormatV(RMGLog::LogLevel loglevelfile, RMGLog::LogLevel loglevelscreen, const char *fmt, va_list args);
+
     /**
      * BAT version number */
     static std::string fVersion;
@@ -0,0 +1,105 @@
+#ifndef _RMG_MPMC_QUEUE_HH_
+#define _RMG_MPMC_QUEUE_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's
+ * algorithm). Each cell carries a sequence number telling producers and
+ * consumers whether it is free or filled for their turn, a push or a pop is
+ * then a single compare-and-swap on the shared position plus one store.
+ *
+ * TryPush() and TryPop() never block, they fail if the queue is full or
+ * empty. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class RMGMPMCQueue {
+
+  public:
+
+    explicit RMGMPMCQueue(size_t capacity) :
+      fCells(RoundUp(capacity)),
+      fMask(fCells.size() - 1) {
+
+      for (size_t i = 0; i < fCells.size(); ++i) fCells[i].sequence.store(i, std::memory_order_relaxed);
+      fEnqueuePos.store(0, std::memory_order_relaxed);
+      fDequeuePos.store(0, std::memory_order_relaxed);
+    }
+    ~RMGMPMCQueue() = default;
+
+    RMGMPMCQueue           (RMGMPMCQueue const&) = delete;
+    RMGMPMCQueue& operator=(RMGMPMCQueue const&) = delete;
+    RMGMPMCQueue           (RMGMPMCQueue&&)      = delete;
+    RMGMPMCQueue& operator=(RMGMPMCQueue&&)      = delete;
+
+    bool TryPush(T&& value) {
+      Cell* cell;
+      auto pos = fEnqueuePos.load(std::memory_order_relaxed);
+      while (true) {
+        cell = &fCells[pos & fMask];
+        auto seq = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+          if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) return false; // full
+        else pos = fEnqueuePos.load(std::memory_order_relaxed);
+      }
+      cell->data = std::move(value);
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool TryPop(T& value) {
+      Cell* cell;
+      auto pos = fDequeuePos.load(std::memory_order_relaxed);
+      while (true) {
+        cell = &fCells[pos & fMask];
+        auto seq = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0) {
+          if (fDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) return false; // empty
+        else pos = fDequeuePos.load(std::memory_order_relaxed);
+      }
+      value = std::move(cell->data);
+      cell->sequence.store(pos + fMask + 1, std::memory_order_release);
+      return true;
+    }
+
+    inline size_t GetCapacity() const { return fMask + 1; }
+
+  private:
+
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T                   data;
+
+      Cell() : sequence(0), data() {}
+    };
+
+    static inline size_t RoundUp(size_t capacity) {
+      size_t n = 2;
+      while (n < capacity) n <<= 1;
+      return n;
+    }
+
+    // producers and consumers update different cache lines
+    static constexpr size_t kCacheLine = 64;
+
+    std::vector<Cell>   fCells;
+    size_t              fMask;
+    char                fPad0[kCacheLine];
+    std::atomic<size_t> fEnqueuePos;
+    char                fPad1[kCacheLine];
+    std::atomic<size_t> fDequeuePos;
+    char                fPad2[kCacheLine];
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,43 @@
+#ifndef _RMG_MAPPED_FILE_HH_
+#define _RMG_MAPPED_FILE_HH_
+
+#include <cstddef>
+
+#include "globals.hh"
+
+/**
+ * Read-only memory mapping of a whole file. Pages are loaded on demand by the
+ * operating system and shared among all the threads (and processes) mapping
+ * the same file.
+ */
+class RMGMappedFile {
+
+  public:
+
+    RMGMappedFile() = default;
+    RMGMappedFile(G4String file_name);
+    ~RMGMappedFile();
+
+    RMGMappedFile           (RMGMappedFile const&) = delete;
+    RMGMappedFile& operator=(RMGMappedFile const&) = delete;
+    RMGMappedFile           (RMGMappedFile&&)      = delete;
+    RMGMappedFile& operator=(RMGMappedFile&&)      = delete;
+
+    G4bool Open(G4String file_name);
+    void Close();
+
+    inline G4bool IsOpen() const { return fData != nullptr; }
+    inline const char* GetData() const { return fData; }
+    inline size_t GetSize() const { return fSize; }
+    inline const G4String& GetFileName() const { return fFileName; }
+
+  private:
+
+    G4String    fFileName;
+    const char* fData = nullptr;
+    size_t      fSize = 0;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,283 @@
+#ifndef _RMG_OUTPUT_MANAGER_HDF5_HH_
+#define _RMG_OUTPUT_MANAGER_HDF5_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4SystemOfUnits.hh"
+
+#include "hdf5.h"
+
+#include "RMGVOutputManager.hh"
+#include "RMGMPMCQueue.hh"
+
+class G4VPhysicalVolume;
+
+/**
+ * Writes the energy depositions of the simulated steps ("hits") to an HDF5
+ * file, as one column (dataset) per quantity in the `/hits` group:
+ *
+ *  - `event_id`, `volume_id` (index in the G4PhysicalVolumeStore, names in
+ *    `/volumes/name`), `source_id` (see RMGEventInformation)
+ *  - `edep` (keV), `x`, `y`, `z` (mm), `t` (ns), `weight`
+ *
+ * The positions are stored as 32-bit floats with FloatPositions.
+ *
+ * During an event the steps are recorded as 32-byte records in a vector
+ * reused from event to event: once the largest event has been seen nothing
+ * is allocated in SteppingAction() anymore. The positions are kept in single
+ * precision there (better than 1 um up to 10 m from the origin), whatever the
+ * output type. At the end of the event the records are appended to the
+ * column buffers of the thread, the event quantities (id, source, weight)
+ * being added only then.
+ *
+ * With ClusterHits, the steps of an event are first merged into clusters:
+ * a step joins a cluster in the same volume if it is closer than the
+ * distance radius to its position and than the time radius to its time.
+ * Clusters keep the total energy, the energy-weighted position and the
+ * earliest time, and are written instead of the steps. A step joins the
+ * latest matching cluster, and clusters move as steps join them: the result
+ * depends on the order of the steps, i.e. on the tracking order. Clusters
+ * are looked up in a hash of the cells (of the distance radius) of each
+ * volume, a step only compares to the clusters of the 27 cells around it.
+ *
+ * Each worker thread fills its own column buffers. Once a buffer holds
+ * ChunkSize rows it is handed over, through a bounded lock-free queue, to a
+ * writer thread that appends it to the datasets in one go. The chunk layout
+ * has the same size, such that every write produces whole compressed chunks
+ * and nothing is ever written row by row. Workers never wait for the disk,
+ * unless the queue is full: this back-pressure is reported at the end of
+ * the run. All threads share the same file and writer thread, buffers are
+ * recycled between workers and writer.
+ *
+ * The file is closed at the end of each run by the last thread leaving it,
+ * the following runs of the same job append to it. Event ids restart from
+ * zero in each run, they are shifted by the number of events of the previous
+ * runs written to the same file, such that they are unique in the whole file.
+ *
+ * Alternatively, with PerThreadFiles, each worker thread writes its own file
+ * (the file name with `-t<thread id>` inserted before the extension) without
+ * sharing anything with the other threads. At the end of the run the master
+ * appends them to the output file and removes them, again in whole chunks.
+ * With the same chunk size, compression and types in all the files, the
+ * full chunks are copied as they are stored, without being decompressed and
+ * compressed again.
+ */
+class RMGOutputManagerHDF5 : public RMGVOutputManager {
+
+  public:
+
+    RMGOutputManagerHDF5();
+    ~RMGOutputManagerHDF5();
+
+    RMGOutputManagerHDF5           (RMGOutputManagerHDF5 const&) = delete;
+    RMGOutputManagerHDF5& operator=(RMGOutputManagerHDF5 const&) = delete;
+    RMGOutputManagerHDF5           (RMGOutputManagerHDF5&&)      = delete;
+    RMGOutputManagerHDF5& operator=(RMGOutputManagerHDF5&&)      = delete;
+
+    void BeginOfRunAction() override;
+    void EndOfRunAction() override;
+    void BeginOfEventAction(const G4Event* event) override;
+    void EndOfEventAction(const G4Event* event) override;
+    void SteppingAction(const G4Step* step, G4SteppingManager*) override;
+    void PrepareNewEvent(const G4Event* = nullptr) override;
+
+    void DefineSchema() override;
+    void OpenFile() override;
+    void CloseFile() override;
+    /// Append all the buffered hits to the file, also incomplete chunks
+    void WriteFile() override;
+
+    inline void SetChunkSize(size_t n) { fChunkSize = n; }
+    inline void SetCompressionLevel(G4int level) { fCompressionLevel = level; }
+    /// Maximum number of buffers waiting to be written
+    inline void SetQueueSize(size_t n) { fQueueSize = n; }
+    /// Each worker thread writes its own file, merged at the end of the run
+    inline void SetPerThreadFiles(G4bool val) { fPerThreadFiles = val; }
+    /// Store the positions in single precision, for new files
+    inline void SetFloatPositions(G4bool val) { fFloatPositions = val; }
+    /// Write clusters of steps instead of the steps themselves
+    inline void SetClusterHits(G4bool val) { fClusterHits = val; }
+    inline void SetClusterDistance(G4double distance) { fClusterDistance = distance / CLHEP::mm; }
+    inline void SetClusterTime(G4double time) { fClusterTime = time / CLHEP::ns; }
+
+    /// Run by the master at the end of each run, once the workers are done,
+    /// with the number of events of the run: advances the event id offset of
+    /// the output file and merges the per-thread files into it. Registered
+    /// as master action of RMGVOutputManager by the constructor
+    static void EndOfMasterRunAction(std::int64_t n_events);
+    /// Record only hits in these physical volumes, all volumes if none is given
+    inline void AddSensitiveVolume(G4String name) { fSensitiveVolumes.insert(name); }
+
+    /// Column buffers, one entry per hit
+    struct HitColumns {
+      std::vector<std::int64_t> event_id;
+      std::vector<std::int32_t> volume_id;
+      std::vector<std::int32_t> source_id;
+      std::vector<G4double>     edep;
+      std::vector<G4double>     x;
+      std::vector<G4double>     y;
+      std::vector<G4double>     z;
+      std::vector<G4double>     t;
+      std::vector<G4double>     weight;
+
+      inline size_t size() const { return event_id.size(); }
+      void Reserve(size_t n);
+      void Resize(size_t n);
+      void Clear();
+      /// Move the rows from the n-th on to the end of `dst`
+      void MoveTail(size_t n, HitColumns& dst);
+    };
+
+  private:
+
+    // builds the map from physical volumes to volume ids
+    void BuildVolumeIDs();
+    // hands the first n buffered rows over to the writer thread, or writes
+    // them to the file of this thread
+    void Submit(size_t n);
+    void OpenThreadFile();
+    void CloseThreadFile();
+    // merges the steps of the event into fClusters
+    void ClusterEventHits();
+
+    // run by the writer thread, the only one touching the file while open
+    static void WriterLoop();
+    // appends the files of the worker threads to the output file, by the master
+    static void MergeThreadFiles();
+
+    // the datasets are in the same order as the HitColumns
+    static std::vector<hid_t> CreateLayout(hid_t file, size_t chunk_size, G4int compression_level,
+        G4bool float_positions);
+    static std::vector<hid_t> OpenDatasets(hid_t file);
+    static void AppendColumns(const std::vector<hid_t>& datasets, const HitColumns& hits, size_t n);
+    static void WriteColumns(const std::vector<hid_t>& datasets, const HitColumns& hits, size_t n, hsize_t offset);
+    static void ReadColumns(const std::vector<hid_t>& datasets, hsize_t offset, size_t n, HitColumns& hits);
+
+    size_t   fChunkSize;
+    G4int    fCompressionLevel;
+    size_t   fQueueSize;
+    G4bool   fPerThreadFiles;
+    G4bool   fFloatPositions;
+    G4bool   fClusterHits;
+    G4double fClusterDistance; // mm
+    G4double fClusterTime;     // ns
+
+    std::set<G4String> fSensitiveVolumes;
+    std::unordered_map<const G4VPhysicalVolume*, std::int32_t> fVolumeIDs;
+
+    // a step of the current event, 32 bytes. The time stays in double
+    // precision, radioactive decays happen at any time
+    struct HitRecord {
+      std::int32_t volume_id;
+      G4float      x, y, z;  // mm
+      G4double     edep;     // keV
+      G4double     t;        // ns
+    };
+    std::vector<HitRecord> fEventHits;
+    std::vector<HitRecord> fClusters;
+
+    // spatial hash of the clusters of the event, open addressing with linear
+    // probing. A cluster is entered again when it moves to another cell, the
+    // entries whose cell is not the current one of the cluster are stale
+    struct ClusterCell {
+      std::int32_t volume_id, ix, iy, iz;
+      inline bool operator==(const ClusterCell& other) const {
+        return volume_id == other.volume_id and ix == other.ix and iy == other.iy and iz == other.iz;
+      }
+    };
+    struct ClusterTableEntry {
+      ClusterCell   cell;
+      std::uint32_t cluster; // kNoCluster for free slots
+    };
+    static constexpr std::uint32_t kNoCluster = 0xffffffff;
+    ClusterCell GetClusterCell(const HitRecord& hit) const;
+    void AddToClusterTable(const ClusterCell& cell, std::uint32_t cluster);
+    std::vector<ClusterTableEntry> fClusterTable;
+    std::vector<ClusterCell>       fClusterCells; // current cell of each cluster
+    // steps and written hits in this run, for the clustering summary
+    long fNSteps;
+    long fNWrittenHits;
+
+    inline void AppendHit(const HitRecord& hit) {
+      fHits.event_id.push_back(fEventID);
+      fHits.volume_id.push_back(hit.volume_id);
+      fHits.source_id.push_back(fSourceID);
+      fHits.edep.push_back(hit.edep);
+      fHits.x.push_back(hit.x);
+      fHits.y.push_back(hit.y);
+      fHits.z.push_back(hit.z);
+      fHits.t.push_back(hit.t);
+      fHits.weight.push_back(fEventWeight);
+    }
+
+    HitColumns fHits;
+    // of the current event
+    std::int64_t fEventIDOffset; // events of the previous runs in the file
+    std::int64_t fEventID;
+    std::int32_t fSourceID;
+    G4double     fEventWeight;
+
+    // the file of this worker thread, in per-thread mode
+    hid_t              fThreadFile;
+    G4String           fThreadFileName;
+    std::vector<hid_t> fThreadDatasets;
+    HitColumns         fSpareHits;
+
+    std::unique_ptr<G4UImessenger> fG4Messenger;
+
+    using Buffer = std::unique_ptr<HitColumns>;
+
+    // the file shared by all the threads, with the same column order as
+    // HitColumns, and its writer
+    struct SharedFile {
+      std::mutex         mutex;   // guards opening and closing
+      hid_t              file = -1;
+      std::vector<hid_t> datasets;
+      G4int              n_users = 0;
+      std::set<G4String> created; // files created by this process
+      G4String           run_file; // written in the current run
+      std::map<G4String, std::int64_t> n_events; // in the finished runs, per file
+
+      std::unique_ptr<RMGMPMCQueue<Buffer>> queue;        // to be written
+      std::unique_ptr<RMGMPMCQueue<Buffer>> free_buffers; // written, to be reused
+      std::thread        writer;
+      std::atomic<bool>  stop{false};
+      // the writer sleeps on it while there is nothing to write
+      std::mutex              wake_mutex;
+      std::condition_variable wake;
+
+      // back-pressure statistics, since the file was opened
+      std::atomic<long>  n_buffers{0};
+      std::atomic<long>  n_stalls{0};
+      std::atomic<long>  stall_time_us{0};
+      std::atomic<long>  depth{0};
+      std::atomic<long>  max_depth{0};
+    };
+    static SharedFile fSharedFile;
+
+    // the files of the worker threads, waiting to be merged by the master
+    struct ThreadFiles {
+      std::mutex         mutex;
+      G4String           target;
+      size_t             chunk_size = 0;
+      G4int              compression_level = 0;
+      G4bool             float_positions = false;
+      std::vector<std::pair<G4int, G4String>> files; // thread id and file name
+    };
+    static ThreadFiles fThreadFiles;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
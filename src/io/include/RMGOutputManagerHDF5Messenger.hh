@@ -0,0 +1,50 @@
+#ifndef _RMG_OUTPUT_MANAGER_HDF5_MESSENGER_HH_
+#define _RMG_OUTPUT_MANAGER_HDF5_MESSENGER_HH_
+
+#include <memory>
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+
+class G4UIcommand;
+class RMGOutputManagerHDF5;
+class RMGOutputManagerHDF5Messenger : public G4UImessenger {
+
+  public:
+
+    RMGOutputManagerHDF5Messenger(RMGOutputManagerHDF5* manager);
+    ~RMGOutputManagerHDF5Messenger() = default;
+
+    RMGOutputManagerHDF5Messenger           (RMGOutputManagerHDF5Messenger const&) = delete;
+    RMGOutputManagerHDF5Messenger& operator=(RMGOutputManagerHDF5Messenger const&) = delete;
+    RMGOutputManagerHDF5Messenger           (RMGOutputManagerHDF5Messenger&&)      = delete;
+    RMGOutputManagerHDF5Messenger& operator=(RMGOutputManagerHDF5Messenger&&)      = delete;
+
+    void SetNewValue(G4UIcommand* command, G4String new_values) override;
+
+  private:
+
+    RMGOutputManagerHDF5* fOutputManager;
+
+    std::unique_ptr<G4UIdirectory>        fDirectory;
+    std::unique_ptr<G4UIcmdWithAnInteger> fChunkSizeCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fCompressionLevelCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fQueueSizeCmd;
+    std::unique_ptr<G4UIcmdWithABool>     fPerThreadFilesCmd;
+    std::unique_ptr<G4UIcmdWithABool>     fFloatPositionsCmd;
+
+    std::unique_ptr<G4UIdirectory>             fClusteringDirectory;
+    std::unique_ptr<G4UIcmdWithABool>          fClusterHitsCmd;
+    std::unique_ptr<G4UIcmdWithADoubleAndUnit> fClusterDistanceCmd;
+    std::unique_ptr<G4UIcmdWithADoubleAndUnit> fClusterTimeCmd;
+    std::unique_ptr<G4UIcmdWithAString>   fAddSensitiveVolumeCmd;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -1,9 +1,13 @@
 #ifndef _RMG_V_OUTPUT_MANAGER_HH_
 #define _RMG_V_OUTPUT_MANAGER_HH_
 
+#include <functional>
+
 #include "globals.hh"
 #include "G4ClassificationOfNewTrack.hh"
 
+#include "RMGEventInformation.hh"
+
 class G4Event;
 class G4Track;
 class G4Step;
@@ -66,6 +70,21 @@ class RMGVOutputManager {
     // By default, does nothing.
     virtual void WriteFile();
 
+    /// Action of the master at the end of each run, once the workers are
+    /// done, with the number of events of the run (e.g. to merge what the
+    /// workers wrote)
+    using MasterRunAction = std::function<void(G4int)>;
+    /// The output managers only exist in the worker threads: they register
+    /// their master action, once per name, such that the master runs it
+    static void RegisterEndOfMasterRunAction(const G4String& name, MasterRunAction action);
+    /// Runs the registered master actions, called by the master run action
+    static void EndOfMasterRunAction(G4int n_events);
+
+    /// Statistical weight of the event, to be written along with its data
+    static inline G4double GetEventWeight(const G4Event* event) {
+      return RMGEventInformation::GetEventWeight(event);
+    }
+
     // getters
     inline G4String GetFileName() { return fFileName; }
     inline G4double GetTimeWindow() { return fTimeWindow; }
@@ -76,7 +95,7 @@ class RMGVOutputManager {
     inline G4bool   GetUseImportanceSamplingWindow() { return fUseImportanceSamplingWindow; }
 
     // setters
-    void SetFileName(G4String& name) { fFileName = name; }
+    void SetFileName(const G4String& name) { fFileName = name; }
     void SetSchemaDefined(G4bool sta) { fSchemaDefined = sta; }
     void SetWaveformsSaved(G4bool saved) { fWaveformsSaved = saved; }
     void SetUseTimeWindow(G4bool val) { fUseTimeWindow = val; }
@@ -86,7 +105,7 @@ class RMGVOutputManager {
 
   protected:
 
-    /*static*/ G4String fFileName;
+    G4String    fFileName;
     G4bool      fUseTimeWindow;               // if true will enable time windowing
     G4double    fTimeWindow;                  // Time Window used in Windowing.
     G4double    fOffsetTime;                  // Holds the cumulative deleted time for a track
@@ -6,6 +6,7 @@
 #include "G4UserLimits.hh"
 
 #include "RMGMaterialTable.hh"
+#include "RMGNavigationTools.hh"
 
 RMGMaterialTable::BathMaterial RMGManagementDetectorConstruction::fBathMaterial = RMGMaterialTable::BathMaterial::kNone;
 
@@ -18,17 +19,17 @@ G4VPhysicalVolume* RMGManagementDetectorConstruction::Construct() {
 
   this->DefineGeometry();
 
-  // TODO: build and return world volume?
-
   for (auto v : *G4PhysicalVolumeStore::GetInstance()) {
-    auto max_step = fPhysVolStepLimits.at(v->GetName());
-    if (max_step > 0) {
-      v->GetLogicalVolume()->SetUserLimits(new G4UserLimits(max_step));
+    auto it = fPhysVolStepLimits.find(v->GetName());
+    if (it != fPhysVolStepLimits.end() and it->second > 0) {
+      v->GetLogicalVolume()->SetUserLimits(new G4UserLimits(it->second));
     }
   }
 
-  // TODO
-  return nullptr;
+  // the geometry is complete, index it once for all the threads
+  RMGNavigationTools::BuildVolumeIndex();
+
+  return RMGNavigationTools::GetWorldVolume();
 }
 
 void RMGManagementDetectorConstruction::ConstructSDandField() {
@@ -14,14 +14,14 @@
 #include "RMGLog.hh"
 
 RMGManagementEventAction::RMGManagementEventAction() {
+
   fG4Messenger = std::unique_ptr<RMGManagementEventActionMessenger>(new RMGManagementEventActionMessenger(this));
 }
 
-RMGManagementEventAction::~RMGManagementEventAction() {
-  // if (fOutputManager) {
-  //   fOutputManager->CloseFile();
-  //   delete fOutputManager;
-  // }
+RMGManagementEventAction::~RMGManagementEventAction() = default;
+
+void RMGManagementEventAction::SetOutputManager(RMGVOutputManager* outr) {
+  fOutputManager = std::unique_ptr<RMGVOutputManager>(outr);
 }
 
 void RMGManagementEventAction::BeginOfEventAction(const G4Event* event) {
@@ -46,12 +46,12 @@ void RMGManagementEventAction::BeginOfEventAction(const G4Event* event) {
         event->GetEventID(), (event->GetEventID()+1.)/tot_events, t_days, t_hours, t_minutes, t_sec);
   }
 
-  // if (fOutputManager) fOutputManager->BeginOfEventAction(event);
+  if (fOutputManager) fOutputManager->BeginOfEventAction(event);
 }
 
-void RMGManagementEventAction::EndOfEventAction(const G4Event*) {
+void RMGManagementEventAction::EndOfEventAction(const G4Event* event) {
 
-  // if (fOutputManager) fOutputManager->EndOfEventAction(event);
+  if (fOutputManager) fOutputManager->EndOfEventAction(event);
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
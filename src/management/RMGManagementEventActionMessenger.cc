@@ -5,6 +5,10 @@
 
 #include "RMGManagementEventAction.hh"
 #include "RMGVOutputManager.hh"
+#include "ProjectInfo.hh"
+#if RMG_HAS_HDF5
+#include "RMGOutputManagerHDF5.hh"
+#endif
 #include "RMGLog.hh"
 #include "RMGTools.hh"
 
@@ -14,7 +18,16 @@ RMGManagementEventActionMessenger::RMGManagementEventActionMessenger(RMGManageme
   G4String directory = "/RMG/Output";
   fEventDirectory = std::unique_ptr<G4UIdirectory>(new G4UIdirectory(directory));
 
-  fSetFileNameCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/FileName", this);
+  // macros are usually executed after the initialization
+  fSetFileNameCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/FileName", this, "",
+      {G4State_PreInit, G4State_Idle});
+
+  G4String schemas = "";
+#if RMG_HAS_HDF5
+  schemas += "HDF5";
+#endif
+  fSetSchemaCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/Schema", this, schemas,
+      {G4State_PreInit, G4State_Idle});
 }
 
 void RMGManagementEventActionMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
@@ -27,6 +40,15 @@ void RMGManagementEventActionMessenger::SetNewValue(G4UIcommand* cmd, G4String n
        RMGLog::Out(RMGLog::fatal, "No output scheme defined!");
      }
   }
+  else if (cmd == fSetSchemaCmd.get()) {
+#if RMG_HAS_HDF5
+    if (new_values == "HDF5") fEventAction->SetOutputManager(new RMGOutputManagerHDF5());
+#endif
+    if (!fEventAction->GetOutputManager()) {
+      RMGLog::Out(RMGLog::fatal, "Output schema '", new_values, "' not available");
+    }
+    fEventAction->SetOutputName(new_values);
+  }
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
@@ -14,14 +14,27 @@
 #include "RMGVGenerator.hh"
 #include "RMGManagementEventAction.hh"
 #include "RMGTools.hh"
+#include "ProjectInfo.hh"
+
+namespace {
+  // the worker threads count themselves when they have no output manager
+  const G4String kNoOutputCounter = "Output/n_threads_without_output";
+
+  void WarnIfNoOutput(const RMGRun& run) {
+    if (run.GetCounterValue(kNoOutputCounter) > 0) {
+      RMGLog::Out(RMGLog::warning, "No output schema specified, no output has been written");
+    }
+  }
+}
 
 G4Run* RMGManagementRunAction::GenerateRun() {
   fRMGRun = new RMGRun();
   return fRMGRun;
 }
 
-RMGManagementRunAction::RMGManagementRunAction(RMGGeneratorPrimary* gene) {
+RMGManagementRunAction::RMGManagementRunAction(RMGGeneratorPrimary* gene, RMGManagementEventAction* event_action) {
   fRMGGeneratorPrimary = gene;
+  fRMGEventAction = event_action;
 }
 
 void RMGManagementRunAction::BeginOfRunAction(const G4Run*) {
@@ -29,13 +42,24 @@ void RMGManagementRunAction::BeginOfRunAction(const G4Run*) {
   RMGLog::Out(RMGLog::detail, "Performing RMG beginning of run actions");
 
   if (fRMGGeneratorPrimary) {
-    fRMGGeneratorPrimary->GetRMGGenerator()->BeginOfRunAction(fRMGRun);
+    fRMGGeneratorPrimary->ClearPrimaryBatch();
+    if (fRMGGeneratorPrimary->GetRMGGenerator()) {
+      fRMGGeneratorPrimary->GetRMGGenerator()->BeginOfRunAction(fRMGRun);
+    }
+    if (fRMGGeneratorPrimary->GetPrimaryPositionGenerator()) {
+      fRMGGeneratorPrimary->GetPrimaryPositionGenerator()->BeginOfRunAction(fRMGRun);
+    }
   }
 
-  // if (manager->GetRMGEventAction()->GetOutputManager()) {
-  //   manager->GetRMGEventAction()->GetOutputManager()->BeginOfRunAction();
-  // }
-  // else RMGLog::Out(RMGLog::warning, "No Output specified!");
+  // the output managers live in the worker threads, with the event actions
+  if (fRMGEventAction) {
+    if (fRMGEventAction->GetOutputManager()) fRMGEventAction->GetOutputManager()->BeginOfRunAction();
+    else {
+      // each worker would warn, the master does it once for all of them
+      fRMGRun->GetCounter(kNoOutputCounter) += 1;
+      RMGRun::RegisterSummary("Output", &WarnIfNoOutput);
+    }
+  }
 
   if (this->IsMaster()) {
     // save start time for future
@@ -52,13 +76,21 @@ void RMGManagementRunAction::BeginOfRunAction(const G4Run*) {
 void RMGManagementRunAction::EndOfRunAction(const G4Run*) {
 
   if (fRMGGeneratorPrimary) {
-    fRMGGeneratorPrimary->GetRMGGenerator()->EndOfRunAction(fRMGRun);
+    if (fRMGGeneratorPrimary->GetRMGGenerator()) {
+      fRMGGeneratorPrimary->GetRMGGenerator()->EndOfRunAction(fRMGRun);
+    }
+    if (fRMGGeneratorPrimary->GetPrimaryPositionGenerator()) {
+      fRMGGeneratorPrimary->GetPrimaryPositionGenerator()->EndOfRunAction(fRMGRun);
+    }
+  }
+  if (fRMGEventAction and fRMGEventAction->GetOutputManager()) {
+    fRMGEventAction->GetOutputManager()->EndOfRunAction();
   }
-  // if (manager->GetRMGEventAction()->GetOutputManager()) {
-  //   manager->GetRMGEventAction()->GetOutputManager()->EndOfRunAction();
-  // }
 
   if (this->IsMaster()) {
+    // the workers are done, e.g. merge their files if they wrote separate ones
+    RMGVOutputManager::EndOfMasterRunAction(fRMGRun->GetNumberOfEventToBeProcessed());
+
     auto time_now = std::chrono::system_clock::now();
     auto tt = RMGTools::ToUTCTime(time_now);
     RMGLog::OutFormat(RMGLog::summary, "Run nr. %i completed. %i (%g) events simulated. Current time is %i/%i/%i %i:%i:%i (UTC)",
@@ -79,6 +111,15 @@ void RMGManagementRunAction::EndOfRunAction(const G4Run*) {
 
       RMGLog::OutFormat(RMGLog::summary, "Stats: average event processing time was %g seconds/event",
           total_sec*1./fRMGRun->GetNumberOfEvent());
+
+      // only relevant if biased sampling was used
+      if (fRMGRun->GetSumOfSquaredWeights() != fRMGRun->GetNumberOfEvent()) {
+        RMGLog::Out(RMGLog::summary, "Stats: sum of event weights is ", fRMGRun->GetSumOfWeights(),
+            ", equivalent to ", fRMGRun->GetEffectiveNumberOfEvents(), " unweighted events");
+      }
+
+      // generator summaries, from the counters of all the workers
+      fRMGRun->PrintSummaries();
   }
 }
 
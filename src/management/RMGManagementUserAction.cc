@@ -1,5 +1,8 @@
 #include "RMGManagementUserAction.hh"
 
+#include "G4Threading.hh"
+
+#include "RMGManager.hh"
 #include "RMGGeneratorPrimary.hh"
 #include "RMGManagementRunAction.hh"
 #include "RMGManagementEventAction.hh"
@@ -15,10 +18,13 @@ void RMGManagementUserAction::BuildForMaster() const {
 
 void RMGManagementUserAction::Build() const {
 
+  // workers are started once the master is fully initialized
+  if (G4Threading::IsWorkerThread()) RMGManager::GetRMGManager()->RecordMasterMemory();
+
   auto generator_primary = new RMGGeneratorPrimary();
   this->SetUserAction(generator_primary);
-  this->SetUserAction(new RMGManagementRunAction(generator_primary));
   auto event_action = new RMGManagementEventAction();
+  this->SetUserAction(new RMGManagementRunAction(generator_primary, event_action));
   this->SetUserAction(event_action);
   this->SetUserAction(new RMGManagementStackingAction(event_action));
   this->SetUserAction(new RMGManagementSteppingAction(event_action));
@@ -5,7 +5,10 @@
 #include <string>
 #include <vector>
 #include <random>
+#include <stdexcept>
+#include <cstdint>
 
+#include "G4Version.hh"
 #include "G4Threading.hh"
 #ifdef G4MULTITHREADED
 #include "G4MTRunManager.hh"
@@ -13,6 +16,9 @@
 #include "G4RunManager.hh"
 #if G4VERSION_NUMBER >= 1070
 #include "G4RunManagerFactory.hh"
+# ifdef G4MULTITHREADED
+# include "G4TaskRunManager.hh"
+# endif
 #endif
 #include "G4VisManager.hh"
 #include "G4VUserPhysicsList.hh"
@@ -30,13 +36,22 @@
 #include "RMGManagementUserAction.hh"
 #include "RMGLog.hh"
 #include "RMGManagerMessenger.hh"
+#include "RMGTools.hh"
 
 RMGManager* RMGManager::fRMGManager = nullptr;
 
 RMGManager::RMGManager(G4String app_name) :
   fApplicationName(app_name),
   fMacroFileName(""),
-  fControlledRandomization(false) {
+  fControlledRandomization(false),
+  fBaseSeed(0),
+  fPerEventSeeding(false),
+  fEventIDOffset(0),
+  fSeedingRunID(-1),
+  fRunManagerType(RunManagerType::kDefault),
+  fNThreads(-1),
+  fEventChunkSize(0),
+  fMasterMemory(0) {
 
   if (fRMGManager) RMGLog::Out(RMGLog::fatal, "RMGManager must be singleton!");
   fRMGManager = this;
@@ -51,14 +66,34 @@ void RMGManager::Initialize() {
 
   if (!fG4RunManager) {
 #if G4VERSION_NUMBER >= 1070
-    fG4RunManager = std::unique_ptr<G4RunManager>(G4RunManagerFactory::CreateRunManager());
-#elif defined(G4MULTITHREADED)
-    fG4RunManager = std::unique_ptr<G4MTRunManager>(new G4MTRunManager());
+    auto type = G4RunManagerType::Default;
+    switch (fRunManagerType) {
+      case RunManagerType::kSerial  : type = G4RunManagerType::Serial;  break;
+      case RunManagerType::kMT      : type = G4RunManagerType::MT;      break;
+      case RunManagerType::kTasking : type = G4RunManagerType::Tasking; break;
+      default : break;
+    }
+    fG4RunManager = std::unique_ptr<G4RunManager>(G4RunManagerFactory::CreateRunManager(type));
 #else
+    if (fRunManagerType == RunManagerType::kTasking) {
+      RMGLog::Out(RMGLog::fatal, "Tasking run manager requires Geant4 10.7 or later");
+    }
+# ifdef G4MULTITHREADED
+    if (fRunManagerType == RunManagerType::kSerial) {
+      fG4RunManager = std::unique_ptr<G4RunManager>(new G4RunManager());
+    }
+    else fG4RunManager = std::unique_ptr<G4MTRunManager>(new G4MTRunManager());
+# else
+    if (fRunManagerType == RunManagerType::kMT) {
+      RMGLog::Out(RMGLog::fatal, "Geant4 has been built without multithreading support");
+    }
     fG4RunManager = std::unique_ptr<G4RunManager>(new G4RunManager());
+# endif
 #endif
   }
 
+  this->ApplyThreadingSettings();
+
   if (!fG4VisManager) fG4VisManager = std::unique_ptr<G4VisManager>(new G4VisExecutive());
   if (!fProcessesList) fProcessesList = new RMGProcessesList();
   if (!fManagementUserAction) fManagementUserAction = new RMGManagementUserAction();
@@ -72,10 +107,139 @@ void RMGManager::Initialize() {
     std::random_device rd; // uses RDRND or /dev/urandom
     auto rand_seed = dist(rd);
     G4Random::setTheSeed(rand_seed);
+    fBaseSeed = rand_seed;
     RMGLog::Out(RMGLog::summary, "CLHEP::HepRandom seed set to: ", rand_seed);
   }
 
   fG4RunManager->Initialize();
+
+  // in sequential mode there are no workers, the master is everything
+  if (!G4Threading::IsMultithreadedApplication()) this->RecordMasterMemory();
+}
+
+namespace {
+
+  // SplitMix64 (Steele, Lea, Flood 2014), a good mixer for counter-based seeds
+  std::uint64_t SplitMix64(std::uint64_t& state) {
+    auto z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+}
+
+void RMGManager::SeedEvent(G4int run_id, G4int event_id) const {
+
+  if (fSeedingRunID >= 0) run_id = fSeedingRunID;
+  std::uint64_t state = static_cast<std::uint64_t>(fBaseSeed);
+  state = SplitMix64(state) ^ static_cast<std::uint64_t>(run_id);
+  state = SplitMix64(state) ^ static_cast<std::uint64_t>(event_id + fEventIDOffset);
+
+  // positive 31 bit seeds, as the Geant4 worker seeding does, zero terminated
+  long seeds[3] = {0, 0, 0};
+  for (int i = 0; i < 2; ++i) {
+    do { seeds[i] = static_cast<long>(SplitMix64(state) >> 33); } while (seeds[i] == 0);
+  }
+  G4Random::setTheSeeds(seeds);
+
+  RMGLog::Out(RMGLog::debug, "Event ", event_id + fEventIDOffset, " of run ", run_id,
+      " seeded with ", seeds[0], " ", seeds[1]);
+}
+
+void RMGManager::SetRunManagerType(G4String type) {
+
+  if (fG4RunManager) {
+    RMGLog::Out(RMGLog::error, "The run manager has already been created, cannot change its type");
+    return;
+  }
+
+  if      (type == "serial" ) fRunManagerType = RunManagerType::kSerial;
+  else if (type == "mt"     ) fRunManagerType = RunManagerType::kMT;
+  else if (type == "tasking") fRunManagerType = RunManagerType::kTasking;
+  else RMGLog::Out(RMGLog::fatal, "Unknown run manager type '", type, "', use serial, mt or tasking");
+}
+
+void RMGManager::SetNumberOfThreads(G4int n_threads) {
+  fNThreads = n_threads;
+  if (fG4RunManager) this->ApplyThreadingSettings();
+}
+
+void RMGManager::SetEventChunkSize(G4int n_events) {
+  fEventChunkSize = n_events;
+  if (fG4RunManager) this->ApplyThreadingSettings();
+}
+
+void RMGManager::ApplyThreadingSettings() {
+
+#ifdef G4MULTITHREADED
+  // the tasking run manager is a G4MTRunManager too
+  auto mt_manager = dynamic_cast<G4MTRunManager*>(fG4RunManager.get());
+#else
+  G4RunManager* mt_manager = nullptr;
+#endif
+  if (!mt_manager) {
+    if (fNThreads > 1) RMGLog::Out(RMGLog::warning, "Sequential run manager, ignoring the number of threads");
+    return;
+  }
+
+#ifdef G4MULTITHREADED
+  if (fNThreads >= 0) {
+    auto n_cpus = RMGTools::GetNumberOfAvailableCPUs();
+    auto n_threads = fNThreads > 0 ? fNThreads : n_cpus;
+    if (n_threads > n_cpus) {
+      RMGLog::Out(RMGLog::warning, n_threads, " threads requested but only ", n_cpus,
+          " CPUs are available to this process (affinity mask and cgroup quota)");
+    }
+    // G4MTRunManager starts its workers once, at the first BeamOn, and ignores
+    // later changes. The tasking run manager resizes its thread pool instead
+    G4bool is_tasking = false;
+# if G4VERSION_NUMBER >= 1070
+    is_tasking = dynamic_cast<G4TaskRunManager*>(mt_manager) != nullptr;
+# endif
+    if (!is_tasking and mt_manager->GetNumberActiveThreads() > 0
+        and n_threads != mt_manager->GetNumberOfThreads()) {
+      RMGLog::Out(RMGLog::warning, "Worker threads already started, the number of threads ",
+          "can't be changed anymore (still ", mt_manager->GetNumberOfThreads(), "). Set it before ",
+          "the first run or use the tasking run manager");
+    }
+    mt_manager->SetNumberOfThreads(n_threads);
+  }
+  // in tasking mode this is the number of events per task
+  if (fEventChunkSize > 0) mt_manager->SetEventModulo(fEventChunkSize);
+
+  RMGLog::Out(RMGLog::summary, "Using ", mt_manager->GetNumberOfThreads(), " worker threads",
+      fEventChunkSize > 0 ? " with event chunks of " + std::to_string(fEventChunkSize) : "");
+#endif
+}
+
+void RMGManager::RecordMasterMemory() {
+  std::call_once(fMasterMemoryFlag, [this]() { fMasterMemory = RMGTools::GetResidentMemory().first; });
+}
+
+void RMGManager::ReportMemory() {
+
+  auto rss = RMGTools::GetResidentMemory();
+  if (rss.first == 0) {
+    RMGLog::Out(RMGLog::warning, "Resident memory information not available on this platform");
+    return;
+  }
+
+  auto to_mb = [](size_t b) { return b / 1048576.; };
+  RMGLog::OutFormat(RMGLog::summary, "Resident memory: %.1f MB (peak %.1f MB)",
+      to_mb(rss.first), to_mb(rss.second));
+
+  if (fMasterMemory == 0) {
+    RMGLog::Out(RMGLog::summary, " - master/worker breakdown not available before the first run");
+    return;
+  }
+  RMGLog::OutFormat(RMGLog::summary, " - master: %.1f MB", to_mb(fMasterMemory));
+
+  auto n_workers = G4Threading::GetNumberOfRunningWorkerThreads();
+  if (n_workers > 0) {
+    auto workers = rss.first > fMasterMemory ? rss.first - fMasterMemory : 0;
+    RMGLog::OutFormat(RMGLog::summary, " - workers: %.1f MB (%d threads, %.1f MB per thread)",
+        to_mb(workers), n_workers, to_mb(workers) / n_workers);
+  }
 }
 
 void RMGManager::Run() {
@@ -95,15 +259,38 @@ void RMGManager::Run() {
 
 G4bool RMGManager::ParseCommandLineArgs(int argc, char** argv) {
 
-    const char* const short_opts = ":h";
+    const char* const short_opts = ":ht:r:";
     const option long_opts[] = {
-        { "help",  no_argument, nullptr, 'h' },
-        { nullptr, no_argument, nullptr, 0   }
+        { "help",        no_argument,       nullptr, 'h' },
+        { "threads",     required_argument, nullptr, 't' },
+        { "run-manager", required_argument, nullptr, 'r' },
+        { nullptr,       no_argument,       nullptr, 0   }
     };
 
     int opt = 0;
     while ((opt = getopt_long(argc, argv, short_opts, long_opts, nullptr)) != -1) {
         switch (opt) {
+            case 't': // -t or --threads
+                try {
+                    auto n = std::stoi(optarg);
+                    if (n < 0) throw std::invalid_argument(optarg);
+                    this->SetNumberOfThreads(n);
+                }
+                catch (const std::exception&) {
+                    RMGLog::Out(RMGLog::error, "Invalid number of threads '", optarg, "'");
+                    this->PrintUsage();
+                    return false;
+                }
+                break;
+            case 'r': // -r or --run-manager
+                if (std::string(optarg) != "serial" and std::string(optarg) != "mt" and
+                    std::string(optarg) != "tasking") {
+                    RMGLog::Out(RMGLog::error, "Invalid run manager type '", optarg, "'");
+                    this->PrintUsage();
+                    return false;
+                }
+                this->SetRunManagerType(optarg);
+                break;
             case 'h': // -h or --help
             case '?': // Unrecognized option
             default:
@@ -124,7 +311,11 @@ G4bool RMGManager::ParseCommandLineArgs(int argc, char** argv) {
 }
 
 void RMGManager::PrintUsage() {
-  std::cout << fApplicationName << ": USAGE" << std::endl;
+  std::cout << fApplicationName << ": USAGE" << std::endl
+            << "  " << fApplicationName << " [options] [macro]" << std::endl << std::endl
+            << "  -h, --help                  print this message" << std::endl
+            << "  -t, --threads N             number of worker threads, 0 for all the available CPUs" << std::endl
+            << "  -r, --run-manager TYPE      serial, mt or tasking" << std::endl;
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
@@ -10,7 +10,8 @@
 #include "RMGLog.hh"
 #include "RMGTools.hh"
 
-RMGManagerMessenger::RMGManagerMessenger(RMGManager*) {
+RMGManagerMessenger::RMGManagerMessenger(RMGManager* manager) :
+  fManager(manager) {
 
   G4String directory = "/RMG/Manager";
   fDirectories.emplace_back(new G4UIdirectory(directory));
@@ -37,6 +38,37 @@ RMGManagerMessenger::RMGManagerMessenger(RMGManager*) {
 
   fUseRandomEngineCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/Randomization/RandomEngine",
       this, "JamesRandom RanLux MTwist");
+
+  fPerEventSeedingCmd = RMGTools::MakeG4UIcmdWithABool(directory + "/Randomization/PerEventSeeding",
+      this, false, {G4State_PreInit, G4State_Idle});
+  fPerEventSeedingCmd->SetGuidance("Seed each event from the base seed and its event id, independently of threads");
+
+  fEventIDOffsetCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/Randomization/EventIDOffset", this, "offset", "offset >= 0", {G4State_PreInit, G4State_Idle});
+  fEventIDOffsetCmd->SetGuidance("Added to the event id when seeding events, to reproduce a given event alone");
+
+  fSeedingRunIDCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(
+      directory + "/Randomization/SeedingRunID", this, "run_id", "", {G4State_PreInit, G4State_Idle});
+  fSeedingRunIDCmd->SetGuidance("Run id used when seeding events instead of the current one, "
+      "to reproduce an event of a later run. Negative values restore the default");
+
+  fReportMemoryCmd = std::unique_ptr<G4UIcommand>(new G4UIcommand((directory + "/ReportMemory").c_str(), this));
+  fReportMemoryCmd->SetGuidance("Print the resident memory of the process, split in master and workers");
+  fReportMemoryCmd->AvailableForStates(G4State_Idle);
+  fReportMemoryCmd->SetToBeBroadcasted(false);
+
+  // the run manager is created in RMGManager::Initialize()
+  fRunManagerTypeCmd = RMGTools::MakeG4UIcmdWithAString(directory + "/RunManagerType", this,
+      "serial mt tasking", {G4State_PreInit});
+
+  fNThreadsCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(directory + "/NThreads", this,
+      "N", "N >= 0", {G4State_PreInit, G4State_Idle});
+  fNThreadsCmd->SetGuidance("Number of worker threads, 0 for all the CPUs available to the process");
+  fNThreadsCmd->SetGuidance("With the mt run manager it can only be changed before the first run");
+
+  fEventChunkSizeCmd = RMGTools::MakeG4UIcmdWithANumber<G4UIcmdWithAnInteger>(directory + "/EventChunkSize", this,
+      "N", "N >= 0", {G4State_PreInit, G4State_Idle});
+  fEventChunkSizeCmd->SetGuidance("Number of events processed by a worker (or a task) at once, 0 for automatic");
 }
 
 void RMGManagerMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
@@ -70,10 +102,12 @@ void RMGManagerMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
       RMGLog::Out(RMGLog::error, "Seed ", new_values, " is too large. Largest possible seed is ",
           std::numeric_limits<long>::max(), ". Setting seed to 0.");
       CLHEP::HepRandom::setTheSeed(0);
+      seed = 0;
     }
     else CLHEP::HepRandom::setTheSeed(seed);
     RMGLog::Out(RMGLog::summary, "CLHEP::HepRandom seed set to: ", seed);
     RMGManager::GetRMGManager()->SetControlledRandomization();
+    RMGManager::GetRMGManager()->SetBaseSeed(seed);
   }
   else if (cmd == fUseInternalSeedCmd.get()) {
 
@@ -87,6 +121,7 @@ void RMGManagerMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
     CLHEP::HepRandom::setTheSeed(seeds[array_index]);
     RMGLog::Out(RMGLog::summary, "CLHEP::HepRandom seed set to: ", seeds[array_index]);
     RMGManager::GetRMGManager()->SetControlledRandomization();
+    RMGManager::GetRMGManager()->SetBaseSeed(seeds[array_index]);
   }
   else if (cmd == fSeedWithDevRandomCmd.get()) {
     std::uniform_int_distribution<int> dist(0, std::numeric_limits<int>::max());
@@ -95,6 +130,7 @@ void RMGManagerMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
     CLHEP::HepRandom::setTheSeed(rand_seed);
     RMGLog::Out(RMGLog::summary, "CLHEP::HepRandom seed set to: ", rand_seed);
     RMGManager::GetRMGManager()->SetControlledRandomization();
+    RMGManager::GetRMGManager()->SetBaseSeed(rand_seed);
   }
   else if (cmd == fUseRandomEngineCmd.get()) {
 
@@ -116,6 +152,27 @@ void RMGManagerMessenger::SetNewValue(G4UIcommand* cmd, G4String new_values) {
       RMGLog::Out(RMGLog::summary, "Using James random engine");
     }
   }
+  else if (cmd == fPerEventSeedingCmd.get()) {
+    fManager->SetPerEventSeeding(fPerEventSeedingCmd->GetNewBoolValue(new_values));
+  }
+  else if (cmd == fEventIDOffsetCmd.get()) {
+    fManager->SetEventIDOffset(fEventIDOffsetCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fSeedingRunIDCmd.get()) {
+    fManager->SetSeedingRunID(fSeedingRunIDCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fReportMemoryCmd.get()) {
+    fManager->ReportMemory();
+  }
+  else if (cmd == fRunManagerTypeCmd.get()) {
+    fManager->SetRunManagerType(new_values);
+  }
+  else if (cmd == fNThreadsCmd.get()) {
+    fManager->SetNumberOfThreads(fNThreadsCmd->GetNewIntValue(new_values));
+  }
+  else if (cmd == fEventChunkSizeCmd.get()) {
+    fManager->SetEventChunkSize(fEventChunkSizeCmd->GetNewIntValue(new_values));
+  }
 }
 
 // vim: tabstop=2 shiftwidth=2 expandtab
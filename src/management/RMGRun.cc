@@ -0,0 +1,30 @@
+#include "RMGRun.hh"
+
+#include "G4RunManager.hh"
+#include "G4AutoLock.hh"
+
+namespace {
+  G4Mutex gSummariesMutex = G4MUTEX_INITIALIZER;
+  std::map<G4String, RMGRun::SummaryAction>& GetSummaries() {
+    static std::map<G4String, RMGRun::SummaryAction> summaries;
+    return summaries;
+  }
+}
+
+RMGRun* RMGRun::GetCurrent() {
+  auto manager = G4RunManager::GetRunManager();
+  return manager ? dynamic_cast<RMGRun*>(manager->GetNonConstCurrentRun()) : nullptr;
+}
+
+void RMGRun::RegisterSummary(const G4String& name, SummaryAction action) {
+  G4AutoLock lock(&gSummariesMutex);
+  GetSummaries()[name] = std::move(action);
+}
+
+void RMGRun::PrintSummaries() const {
+  // the workers are done, nobody registers anything anymore
+  G4AutoLock lock(&gSummariesMutex);
+  for (const auto& summary : GetSummaries()) summary.second(*this);
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,59 @@
+#ifndef _RMG_EVENT_INFORMATION_HH_
+#define _RMG_EVENT_INFORMATION_HH_
+
+#include "globals.hh"
+#include "G4Event.hh"
+#include "G4VUserEventInformation.hh"
+
+#include "RMGLog.hh"
+
+/**
+ * remage specific event information, attached to each event by
+ * RMGGeneratorPrimary. It carries the statistical weight of the event, as
+ * set by the generator and the primary position sampler: biased sampling
+ * modes generate events with weights different from one and every quantity
+ * derived from the simulation must be weighted accordingly. Composite
+ * generators also record which of their sources produced the event.
+ */
+class RMGEventInformation : public G4VUserEventInformation {
+
+  public:
+
+    inline RMGEventInformation() : fWeight(1), fSourceID(-1) {}
+    ~RMGEventInformation() = default;
+
+    inline void Print() const override {
+      RMGLog::Out(RMGLog::summary, "Event weight: ", fWeight, ", source: ", fSourceID);
+    }
+
+    inline G4double GetWeight() const { return fWeight; }
+    inline void SetWeight(G4double w) { fWeight = w; }
+    /// Index of the source in the composite generator, -1 if not applicable
+    inline G4int GetSourceID() const { return fSourceID; }
+    inline void SetSourceID(G4int id) { fSourceID = id; }
+
+    /// The information attached to the event, created if not there yet
+    static inline RMGEventInformation* GetOrCreate(G4Event* event) {
+      auto info = dynamic_cast<RMGEventInformation*>(event->GetUserInformation());
+      if (!info) {
+        info = new RMGEventInformation();
+        event->SetUserInformation(info);
+      }
+      return info;
+    }
+
+    /// Weight of the event, one if the event has no remage information
+    static inline G4double GetEventWeight(const G4Event* event) {
+      auto info = dynamic_cast<const RMGEventInformation*>(event->GetUserInformation());
+      return info ? info->GetWeight() : 1;
+    }
+
+  private:
+
+    G4double fWeight;
+    G4int    fSourceID;
+};
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
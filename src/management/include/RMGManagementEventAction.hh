@@ -24,16 +24,16 @@ class RMGManagementEventAction : public G4UserEventAction {
     void BeginOfEventAction(const G4Event*) override;
     void EndOfEventAction(const G4Event*) override;
 
-    inline void SetOutputManager(RMGVOutputManager* outr) { fOutputManager = outr; }
+    void SetOutputManager(RMGVOutputManager* outr);
     inline void SetOutputName(const G4String name) { fOutputName = name; }
 
-    inline RMGVOutputManager* GetOutputManager() { return fOutputManager; }
+    inline RMGVOutputManager* GetOutputManager() { return fOutputManager.get(); }
     inline G4String GetOutputName() { return fOutputName; }
 
   private:
 
     std::unique_ptr<RMGManagementEventActionMessenger> fG4Messenger;
-    RMGVOutputManager* fOutputManager; ///> Pointer to the output class. Set via user interface
+    std::unique_ptr<RMGVOutputManager> fOutputManager; ///> Output class, set via user interface
     G4String fOutputName; ///> Name of output schema (as selected by user)
 };
 
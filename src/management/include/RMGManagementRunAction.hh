@@ -9,12 +9,13 @@
 class G4Run;
 class RMGRun;
 class RMGGeneratorPrimary;
+class RMGManagementEventAction;
 class RMGManagementRunAction : public G4UserRunAction {
 
   public:
 
     RMGManagementRunAction() = default;
-    RMGManagementRunAction(RMGGeneratorPrimary*);
+    RMGManagementRunAction(RMGGeneratorPrimary*, RMGManagementEventAction* = nullptr);
     ~RMGManagementRunAction() = default;
 
     RMGManagementRunAction           (RMGManagementRunAction const&) = delete;
@@ -28,8 +29,9 @@ class RMGManagementRunAction : public G4UserRunAction {
 
   private:
 
-    RMGRun* fRMGRun;
-    RMGGeneratorPrimary* fRMGGeneratorPrimary;
+    RMGRun* fRMGRun = nullptr;
+    RMGGeneratorPrimary* fRMGGeneratorPrimary = nullptr;
+    RMGManagementEventAction* fRMGEventAction = nullptr;
 };
 
 #endif
@@ -2,6 +2,7 @@
 #define _RMG_MANAGER_HH_
 
 #include <memory>
+#include <mutex>
 
 #include "globals.hh"
 
@@ -16,6 +17,13 @@ class RMGManager {
 
   public:
 
+    enum RunManagerType {
+      kDefault, // Geant4 default, can be overridden with G4RUN_MANAGER_TYPE
+      kSerial,
+      kMT,
+      kTasking
+    };
+
     RMGManager() = delete;
     RMGManager(G4String app_name);
     ~RMGManager();
@@ -43,14 +51,64 @@ class RMGManager {
     void Initialize();
     void Run();
 
+    /// Type of the run manager created in Initialize()
+    void SetRunManagerType(G4String type);
+    /// Number of worker threads, zero means all the CPUs available to the
+    /// process (see RMGTools::GetNumberOfAvailableCPUs())
+    void SetNumberOfThreads(G4int n_threads);
+    /// Number of events a worker (or a task) processes before fetching new
+    /// ones from the master, zero lets Geant4 decide
+    void SetEventChunkSize(G4int n_events);
+
     inline void SetControlledRandomization() { fControlledRandomization = true; }
     inline G4bool GetControlledRandomization() { return fControlledRandomization; }
+    /// Seed the master engine was initialized with, base of the event seeds
+    inline void SetBaseSeed(long seed) { fBaseSeed = seed; }
+    inline long GetBaseSeed() const { return fBaseSeed; }
+
+    /// In this mode the random engine is re-seeded at the start of each event
+    /// from (base seed, run id, event id + offset) with a counter-based hash.
+    /// Events do not depend on the thread that processed them nor on the
+    /// events that came before: any of them can be reproduced alone by setting
+    /// the same base seed, the offset to its event id and, unless it was in
+    /// the first run, the run id override to its run id
+    inline void SetPerEventSeeding(G4bool flag) { fPerEventSeeding = flag; }
+    inline G4bool GetPerEventSeeding() const { return fPerEventSeeding; }
+    inline void SetEventIDOffset(G4long offset) { fEventIDOffset = offset; }
+    inline G4long GetEventIDOffset() const { return fEventIDOffset; }
+    /// Run id used for seeding instead of the current one, if not negative
+    inline void SetSeedingRunID(G4int run_id) { fSeedingRunID = run_id; }
+    inline G4int GetSeedingRunID() const { return fSeedingRunID; }
+    /// Seed the random engine of the calling thread for the given event
+    void SeedEvent(G4int run_id, G4int event_id) const;
+
+    /// Snapshot of the resident memory once the master initialization is
+    /// complete, called by the first worker thread that builds its actions
+    void RecordMasterMemory();
+    /// Print the resident memory of the process, split in master and worker
+    /// contributions. Threads share the address space: the per-worker figure
+    /// is the average growth since the master snapshot
+    void ReportMemory();
 
   private:
 
+    // forwards thread count and chunk size to the (multithreaded) run manager
+    void ApplyThreadingSettings();
+
     G4String fApplicationName;
     G4String fMacroFileName;
     G4bool   fControlledRandomization;
+    long     fBaseSeed;
+    G4bool   fPerEventSeeding;
+    G4long   fEventIDOffset;
+    G4int    fSeedingRunID;
+
+    RunManagerType fRunManagerType;
+    G4int          fNThreads;        // negative means Geant4 default
+    G4int          fEventChunkSize;
+
+    std::once_flag fMasterMemoryFlag;
+    size_t         fMasterMemory;
 
     static RMGManager* fRMGManager;
     std::unique_ptr<G4RunManager> fG4RunManager;
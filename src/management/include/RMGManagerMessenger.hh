@@ -10,9 +10,9 @@
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithAnInteger.hh"
 #include "G4UIcmdWithABool.hh"
+#include "G4UIcommand.hh"
 
 class RMGManager;
-class G4UIcommand;
 class RMGManagerMessenger: public G4UImessenger {
 
   public:
@@ -29,6 +29,8 @@ class RMGManagerMessenger: public G4UImessenger {
 
   private:
 
+    RMGManager* fManager;
+
     std::vector<std::unique_ptr<G4UIdirectory>> fDirectories;
 
     std::unique_ptr<G4UIcmdWithAString>   fScreenLogCmd;
@@ -38,6 +40,13 @@ class RMGManagerMessenger: public G4UImessenger {
     std::unique_ptr<G4UIcmdWithAnInteger> fHEPRandomSeedCmd;
     std::unique_ptr<G4UIcmdWithAnInteger> fUseInternalSeedCmd;
     std::unique_ptr<G4UIcmdWithABool>     fSeedWithDevRandomCmd;
+    std::unique_ptr<G4UIcmdWithABool>     fPerEventSeedingCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fEventIDOffsetCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fSeedingRunIDCmd;
+    std::unique_ptr<G4UIcommand>          fReportMemoryCmd;
+    std::unique_ptr<G4UIcmdWithAString>   fRunManagerTypeCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fNThreadsCmd;
+    std::unique_ptr<G4UIcmdWithAnInteger> fEventChunkSizeCmd;
 };
 
 #endif
@@ -2,21 +2,74 @@
 #define _RMG_RUN_HH_
 
 #include <chrono>
+#include <functional>
+#include <map>
 
 #include "G4Run.hh"
+#include "G4Event.hh"
+
+#include "RMGEventInformation.hh"
 
 class RMGRun : public G4Run {
 
   public:
 
     using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
+    /// Summary printed by the master at the end of each run, from the merged run
+    using SummaryAction = std::function<void(const RMGRun&)>;
+
+    /// Run of the calling thread, null if there is none
+    static RMGRun* GetCurrent();
+
+    /// Components living in the worker threads (e.g. the generators) register
+    /// their summary, once per name, such that the master prints it
+    static void RegisterSummary(const G4String& name, SummaryAction action);
+    /// Runs the registered summaries, called by the master run action
+    void PrintSummaries() const;
 
     inline const TimePoint& GetStartTime() const { return fStartTime; }
     inline void SetStartTime(TimePoint t) { fStartTime = t; }
 
+    inline void RecordEvent(const G4Event* event) override {
+      auto w = RMGEventInformation::GetEventWeight(event);
+      fSumOfWeights += w;
+      fSumOfSquaredWeights += w*w;
+      G4Run::RecordEvent(event);
+    }
+
+    inline void Merge(const G4Run* run) override {
+      auto rmg_run = dynamic_cast<const RMGRun*>(run);
+      if (rmg_run) {
+        fSumOfWeights += rmg_run->fSumOfWeights;
+        fSumOfSquaredWeights += rmg_run->fSumOfSquaredWeights;
+        for (const auto& c : rmg_run->fCounters) fCounters[c.first] += c.second;
+      }
+      G4Run::Merge(run);
+    }
+
+    inline G4double GetSumOfWeights() const { return fSumOfWeights; }
+    inline G4double GetSumOfSquaredWeights() const { return fSumOfSquaredWeights; }
+    /// Number of unweighted events with the same statistical power
+    inline G4double GetEffectiveNumberOfEvents() const {
+      return fSumOfSquaredWeights > 0 ? fSumOfWeights*fSumOfWeights / fSumOfSquaredWeights : 0;
+    }
+
+    /// Named counters, summed over the worker runs. The worker runs are merged
+    /// before their end of run actions, counters must be filled during the
+    /// event loop. References stay valid as long as the run
+    inline G4double& GetCounter(const G4String& name) { return fCounters[name]; }
+    inline G4double GetCounterValue(const G4String& name) const {
+      auto it = fCounters.find(name);
+      return it == fCounters.end() ? 0 : it->second;
+    }
+    inline const std::map<G4String, G4double>& GetCounters() const { return fCounters; }
+
   private:
 
     TimePoint fStartTime;
+    G4double  fSumOfWeights = 0;
+    G4double  fSumOfSquaredWeights = 0;
+    std::map<G4String, G4double> fCounters;
 };
 
 #endif
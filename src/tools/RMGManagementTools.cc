@@ -1,5 +1,13 @@
 #include "RMGTools.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sched.h>
+
 #include "RMGLog.hh"
 
 std::tm RMGTools::ToUTCTime(std::chrono::time_point<std::chrono::system_clock> stl_t) {
@@ -15,4 +23,51 @@ std::tm RMGTools::ToUTCTime(std::chrono::time_point<std::chrono::system_clock> s
   }
 }
 
+std::pair<size_t, size_t> RMGTools::GetResidentMemory() {
+
+  std::pair<size_t, size_t> rss(0, 0);
+
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    // lines look like "VmRSS:     123456 kB"
+    auto is_rss = line.compare(0, 6, "VmRSS:") == 0;
+    auto is_hwm = line.compare(0, 6, "VmHWM:") == 0;
+    if (!is_rss and !is_hwm) continue;
+    std::istringstream ss(line.substr(6));
+    size_t kb = 0;
+    ss >> kb;
+    (is_rss ? rss.first : rss.second) = kb * 1024;
+  }
+
+  return rss;
+}
+
+G4int RMGTools::GetNumberOfAvailableCPUs() {
+
+  G4int n_cpus = std::max(1u, std::thread::hardware_concurrency());
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) n_cpus = std::max(1, CPU_COUNT(&cpu_set));
+
+  // cgroup v2: "<quota> <period>", the quota is "max" if unlimited
+  double quota = -1, period = -1;
+  std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+  std::string quota_str;
+  if (cpu_max >> quota_str >> period and quota_str != "max") quota = std::stod(quota_str);
+  // cgroup v1, the quota is negative if unlimited
+  if (quota < 0) {
+    std::ifstream cfs_quota("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    std::ifstream cfs_period("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    if (!(cfs_quota >> quota and cfs_period >> period)) quota = -1;
+  }
+
+  if (quota > 0 and period > 0) {
+    n_cpus = std::min(n_cpus, std::max(1, static_cast<G4int>(std::ceil(quota / period))));
+  }
+
+  return n_cpus;
+}
+
 // vim: shiftwidth=2 tabstop=2 expandtab 
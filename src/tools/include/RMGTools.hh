@@ -19,6 +19,15 @@ namespace RMGTools {
 
   std::tm ToUTCTime(std::chrono::time_point<std::chrono::system_clock> t);
 
+  /// Resident set size of the process (current and peak), in bytes. Read from
+  /// /proc/self/status, zero where not available
+  std::pair<size_t, size_t> GetResidentMemory();
+
+  /// Number of CPUs the process may actually use: the affinity mask, further
+  /// limited by the cgroup CPU quota (v1 or v2) when running in a container
+  /// or batch slot
+  G4int GetNumberOfAvailableCPUs();
+
   template <class T> // G4UIcmdWithA[...]
   std::unique_ptr<T> MakeG4UIcmdWithANumber(G4String name, G4UImessenger* msg, G4String par_name="",
       G4String range="", std::vector<G4ApplicationState> avail_for={G4State_Init, G4State_PreInit});
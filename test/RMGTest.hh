@@ -0,0 +1,41 @@
+#ifndef _RMG_TEST_HH_
+#define _RMG_TEST_HH_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/**
+ * Minimal checks for the unit tests: failed checks are printed and counted,
+ * the test executable returns RMGTest::Result() to ctest
+ */
+namespace RMGTest {
+
+  inline int& Failures() { static int n = 0; return n; }
+
+  inline bool Check(bool ok, const char* expr, const char* file, int line) {
+    if (!ok) {
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+      Failures()++;
+    }
+    return ok;
+  }
+
+  inline bool Close(double a, double b, double rel_tol) {
+    return std::abs(a - b) <= rel_tol * std::max(std::abs(a), std::abs(b)) or a == b;
+  }
+
+  inline int Result() {
+    if (Failures() > 0) std::fprintf(stderr, "%d check(s) failed\n", Failures());
+    else std::printf("all checks passed\n");
+    return Failures() > 0 ? 1 : 0;
+  }
+}
+
+#define RMG_CHECK(cond) RMGTest::Check((cond), #cond, __FILE__, __LINE__)
+#define RMG_CHECK_CLOSE(a, b, rel_tol) \
+  RMGTest::Check(RMGTest::Close((a), (b), (rel_tol)), #a " == " #b, __FILE__, __LINE__)
+
+#endif
+
+// vim: tabstop=2 shiftwidth=2 expandtab
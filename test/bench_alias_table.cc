@@ -0,0 +1,68 @@
+// Weighted selection of a sampleable object: Walker alias table, as used by
+// RMGGeneratorVolumeConfinement, against the linear scan over the cumulative
+// weights it replaced. The same uniform numbers are fed to both, the mean
+// selected index must agree
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "globals.hh"
+
+#include "RMGAliasTable.hh"
+
+namespace {
+
+  const size_t kNDraws = 20000000;
+  const size_t kNUniforms = 1 << 20;
+
+  // SampleableObjectCollection::VolumeWeightedRand() before the alias tables
+  size_t LinearSample(const std::vector<G4double>& weights, G4double total, G4double u) {
+    auto choice = total * u;
+    G4double w = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      if (choice > w and choice <= w + weights[i]) return i;
+      w += weights[i];
+    }
+    return weights.size() - 1;
+  }
+
+  template <typename F>
+  void Time(const char* name, size_t n_objects, F sample) {
+    size_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kNDraws; ++i) sum += sample(i % kNUniforms);
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(stop - start).count() / kNDraws;
+    std::printf("%-8s %6zu objects: %7.2f ns/draw, mean index %.2f\n", name, n_objects, ns,
+        static_cast<double>(sum) / kNDraws);
+  }
+}
+
+int main() {
+
+  std::mt19937_64 engine(12345);
+  std::uniform_real_distribution<G4double> uniform(0, 1);
+
+  std::vector<G4double> u(kNUniforms);
+  for (auto& x : u) x = uniform(engine);
+
+  for (size_t n : {4, 32, 256, 2048}) {
+    // volumes spanning a few orders of magnitude
+    std::vector<G4double> weights(n);
+    G4double total = 0;
+    for (auto& w : weights) { w = std::pow(10, 3 * uniform(engine)); total += w; }
+
+    RMGAliasTable table;
+    table.Build(weights);
+
+    Time("linear", n, [&](size_t i) { return LinearSample(weights, total, u[i]); });
+    Time("alias", n, [&](size_t i) { return table.Sample(u[i]); });
+  }
+
+  return 0;
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,136 @@
+// Cost of the step recording of RMGOutputManagerHDF5: steps per second of a
+// stand-in stepping loop (sampling a step length and a direction, about what
+// the transport of one step costs without geometry) with the recording off,
+// and with the recording on, i.e. one record per step in a reused vector,
+// copied to the output columns at the end of the event. The columns are
+// emptied every kChunkSize rows, as if written to the file. The 48-byte
+// double precision record is compared with the 32-byte one in use
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+  const size_t kNEvents = 200000;
+  const size_t kChunkSize = 65536;
+
+  struct HitRecord48 {
+    std::int32_t volume_id;
+    double       x, y, z;
+    double       edep;
+    double       t;
+  };
+
+  struct HitRecord32 {
+    std::int32_t volume_id;
+    float        x, y, z;
+    double       edep;
+    double       t;
+  };
+
+  struct HitColumns {
+    std::vector<std::int64_t> event_id;
+    std::vector<std::int32_t> volume_id;
+    std::vector<std::int32_t> source_id;
+    std::vector<double>       edep, x, y, z, t, weight;
+
+    template <typename R>
+    void Append(std::int64_t event, const R& hit) {
+      event_id.push_back(event); volume_id.push_back(hit.volume_id); source_id.push_back(0);
+      edep.push_back(hit.edep); x.push_back(hit.x); y.push_back(hit.y); z.push_back(hit.z);
+      t.push_back(hit.t); weight.push_back(1);
+    }
+
+    // stands for the chunk write, returns something depending on the content
+    double Flush() {
+      double sum = 0;
+      for (auto e : edep) sum += e;
+      event_id.clear(); volume_id.clear(); source_id.clear(); edep.clear();
+      x.clear(); y.clear(); z.clear(); t.clear(); weight.clear();
+      return sum;
+    }
+  };
+
+  // the tracking of one step: exponential step length, isotropic direction
+  struct Stepper {
+    std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+    double x = 0, y = 0, z = 0, t = 0;
+
+    inline double Uniform() {
+      state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+      return ((state >> 11) + 0.5) * (1. / 9007199254740992.);
+    }
+
+    inline void Step() {
+      auto length = -std::log(Uniform());
+      auto cos_theta = 2 * Uniform() - 1, phi = 2 * M_PI * Uniform();
+      auto sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+      x += length * sin_theta * std::cos(phi);
+      y += length * sin_theta * std::sin(phi);
+      z += length * cos_theta;
+      t += 0.01 * length;
+    }
+  };
+
+  template <typename F>
+  double Time(const char* name, const std::vector<size_t>& n_steps, F simulate_event) {
+    HitColumns columns;
+    Stepper stepper;
+    double sum = 0;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t e = 0; e < n_steps.size(); ++e) {
+      sum += simulate_event(e, n_steps[e], stepper, columns);
+      total += n_steps[e];
+      if (columns.edep.size() >= kChunkSize) sum += columns.Flush();
+    }
+    sum += columns.Flush();
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(stop - start).count() / total;
+    std::printf("%-12s: %6.2f Msteps/s, %6.2f ns/step (checksum %.6g)\n", name, 1e3 / ns, ns, sum);
+    return ns;
+  }
+
+  template <typename R>
+  double TimeRecording(const char* name, const std::vector<size_t>& n_steps) {
+    std::vector<R> hits;
+    return Time(name, n_steps, [&hits](size_t e, size_t n, Stepper& stepper, HitColumns& columns) {
+      hits.clear();
+      for (size_t s = 0; s < n; ++s) {
+        stepper.Step();
+        hits.push_back({static_cast<std::int32_t>(s % 7), static_cast<decltype(R::x)>(stepper.x),
+            static_cast<decltype(R::y)>(stepper.y), static_cast<decltype(R::z)>(stepper.z),
+            1e-3 * (s + 1), stepper.t});
+      }
+      for (const auto& hit : hits) columns.Append(e, hit);
+      return 0.;
+    });
+  }
+}
+
+int main() {
+
+  // steps per event spanning from single hits to showers
+  std::mt19937_64 engine(12345);
+  std::geometric_distribution<size_t> steps(1. / 300);
+  std::vector<size_t> n_steps(kNEvents);
+  for (auto& n : n_steps) n = steps(engine) + 1;
+
+  auto off = Time("off", n_steps, [](size_t, size_t n, Stepper& stepper, HitColumns&) {
+    for (size_t s = 0; s < n; ++s) stepper.Step();
+    return stepper.x + stepper.y + stepper.z;
+  });
+  auto on48 = TimeRecording<HitRecord48>("on, 48 bytes", n_steps);
+  auto on32 = TimeRecording<HitRecord32>("on, 32 bytes", n_steps);
+
+  std::printf("recording overhead: %.2f ns/step (48 bytes), %.2f ns/step (32 bytes)\n",
+      on48 - off, on32 - off);
+
+  return 0;
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,180 @@
+// Vertex sampling in a solid: sampler functor resolved once with
+// RMGGeneratorUtil::MakeSampler(), as used by RMGGeneratorVolumeConfinement,
+// against the sampling code it replaced, which resolved the solid type by
+// string comparison at every call and rebuilt the contour triangulation of
+// polycones for every vertex. The legacy code is copied here verbatim (but
+// for the namespace), including its known flaws (non-uniform spheres and
+// tubes): only its cost matters
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Box.hh"
+#include "G4Tubs.hh"
+#include "G4Sphere.hh"
+#include "G4Polycone.hh"
+#include "Randomize.hh"
+
+#include "RMGGeneratorUtil.hh"
+
+namespace legacy {
+
+  G4ThreeVector rand(const G4Box* box, G4bool on_surface) {
+
+    auto dx = box->GetXHalfLength();
+    auto dy = box->GetYHalfLength();
+    auto dz = box->GetZHalfLength();
+
+    if (on_surface) {
+      auto A1 = 4*dx*dy, A2 = 4*dx*dz, A3 = 4*dy*dz;
+      auto face = G4UniformRand()*(A1 + A2 + A3);
+      auto face_sign = G4UniformRand() <= 0.5 ? -1 : 1;
+      G4double x, y, z;
+
+      if (face <= A1) {
+        x = dx*(2*G4UniformRand()-1); y = dy*(2*G4UniformRand()-1); z = dz*face_sign;
+      }
+      else if (face > A1 and face <= A2) {
+        x = dx*(2*G4UniformRand()-1); y = dy*face_sign; z = dz*(2*G4UniformRand()-1);
+      }
+      else {
+        x = dx*face_sign; y = dy*(2*G4UniformRand()-1); z = dz*(2*G4UniformRand()-1);
+      }
+      return G4ThreeVector(x, y, z);
+    }
+    else {
+      return G4ThreeVector(dx * (2*G4UniformRand() - 1),
+                           dy * (2*G4UniformRand() - 1),
+                           dz * (2*G4UniformRand() - 1));
+    }
+  }
+
+  G4ThreeVector rand(const G4Sphere* sphere, G4bool on_surface) {
+
+    auto r1 = sphere->GetInnerRadius();
+    auto r2 = sphere->GetOuterRadius();
+    auto phi1 = sphere->GetStartPhiAngle();
+    auto delta_phi = sphere->GetDeltaPhiAngle();
+    auto cos_theta1 = sphere->GetCosStartTheta();
+    auto delta_cos_theta = std::abs(sphere->GetCosEndTheta() - cos_theta1);
+
+    auto phi = phi1 + delta_phi * G4UniformRand();
+    auto cos_theta = delta_cos_theta*G4UniformRand() + cos_theta1;
+    auto s2_point = G4ThreeVector(std::cos(phi), std::sin(phi), cos_theta) / std::sqrt(1 + cos_theta*cos_theta);
+
+    if (on_surface) {
+      auto A1 = delta_cos_theta*delta_phi*r1*r1;
+      auto A2 = delta_cos_theta*delta_phi*r2*r2;
+      auto side = G4UniformRand()*(A1+A2);
+      if (side <= A1) return s2_point * r1;
+      else return s2_point * r2;
+    }
+    else {
+      auto R = G4UniformRand()*(r2-r1) + r1;
+      return s2_point * R;
+    }
+  }
+
+  G4ThreeVector rand(const G4Tubs* tub, G4bool on_surface) {
+
+    auto r1 = tub->GetInnerRadius();
+    auto r2 = tub->GetOuterRadius();
+    auto h  = 2*tub->GetZHalfLength();
+    auto a = tub->GetStartPhiAngle();
+    auto delta_a = tub->GetDeltaPhiAngle();
+
+    auto phi = a + delta_a * G4UniformRand();
+    auto z = h * (G4UniformRand() - 0.5);
+    auto s1_point = G4ThreeVector(std::cos(phi), std::sin(phi), 0);
+
+    if (on_surface) {
+      auto A1 = delta_a*r1*h;
+      auto A2 = delta_a*r2*h;
+      auto A3 = delta_a*(r2*r2 - r1*r1);
+      auto face = G4UniformRand()*(A1+A2+A3*2);
+      if (face <= A1) return s1_point*r1 + G4ThreeVector(0, 0, z);
+      else if (face > A1 and face <= A2) return s1_point*r2 + G4ThreeVector(0, 0, z);
+      else {
+        auto face_sign = G4UniformRand() <= 0.5 ? 1 : -1;
+        auto R = G4UniformRand()*(r2-r1) + r1;
+        return s1_point*R + G4ThreeVector(0, 0, face_sign * h/2);
+      }
+    }
+    else {
+      auto R = G4UniformRand()*(r2-r1) + r1;
+      return s1_point*R + G4ThreeVector(0, 0, z);
+    }
+  }
+
+  G4ThreeVector rand(const G4Polycone* polycone, G4bool on_surface) {
+    std::vector<G4TwoVector> contour;
+    for (G4int i = 0; i < polycone->GetNumRZCorner(); ++i) {
+      contour.emplace_back(polycone->GetCorner(i).r, polycone->GetCorner(i).z);
+    }
+    return RMGGeneratorUtil::RZContourSampler(contour, polycone->GetStartPhi(),
+        polycone->GetEndPhi() - polycone->GetStartPhi()).Sample(on_surface);
+  }
+
+  // the G4Orb, G4Cons, G4Trd and other branches are not exercised here
+  G4ThreeVector rand(const G4VSolid* vol, G4bool on_surface) {
+    auto entity = vol->GetEntityType();
+    if (entity == "G4Sphere") return legacy::rand(dynamic_cast<const G4Sphere*>(vol), on_surface);
+    if (entity == "G4Box")    return legacy::rand(dynamic_cast<const G4Box*>(vol), on_surface);
+    if (entity == "G4Tubs")   return legacy::rand(dynamic_cast<const G4Tubs*>(vol), on_surface);
+    if (entity == "G4Polycone") return legacy::rand(dynamic_cast<const G4Polycone*>(vol), on_surface);
+    return G4ThreeVector();
+  }
+}
+
+namespace {
+
+  const size_t kNDraws = 2000000;
+
+  template <typename F>
+  double Time(const char* name, const G4VSolid* solid, G4bool on_surface, size_t n_draws, F sample) {
+    G4ThreeVector sum;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n_draws; ++i) sum += sample();
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(stop - start).count() / n_draws;
+    std::printf("%-8s %-10s %-7s: %9.2f ns/vertex (mean radius %.2f mm)\n", name,
+        solid->GetEntityType().c_str(), on_surface ? "surface" : "volume", ns, (sum / n_draws).mag());
+    return ns;
+  }
+}
+
+int main() {
+
+  G4double r[] = {0, 30*mm, 40*mm, 40*mm, 20*mm, 5*mm, 5*mm, 0};
+  G4double z[] = {-40*mm, -40*mm, 0, 10*mm, 40*mm, 40*mm, 10*mm, 10*mm};
+
+  std::vector<G4VSolid*> solids = {
+    new G4Box("box", 10*mm, 20*mm, 30*mm),
+    new G4Tubs("tubs", 5*mm, 40*mm, 30*mm, 0, 270*deg),
+    new G4Sphere("sphere", 10*mm, 40*mm, 0, 360*deg, 0, 120*deg),
+    new G4Polycone("polycone", 0, 360*deg, 8, r, z)
+  };
+
+  for (auto solid : solids) {
+    // rebuilding the triangulation for every vertex is slow, fewer draws
+    auto n_draws = solid->GetEntityType() == "G4Polycone" ? kNDraws / 20 : kNDraws;
+    for (G4bool on_surface : {false, true}) {
+      auto sampler = RMGGeneratorUtil::MakeSampler(solid);
+      auto t_legacy = Time("legacy", solid, on_surface, n_draws,
+          [&]() { return legacy::rand(solid, on_surface); });
+      auto t_functor = Time("functor", solid, on_surface, n_draws, [&]() { return sampler(on_surface); });
+      std::printf("  speed-up %.1fx\n", t_legacy / t_functor);
+    }
+  }
+
+  for (auto solid : solids) delete solid;
+
+  return 0;
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,79 @@
+// The alias table must reproduce the distribution it was built from: the
+// measure of the uniform numbers mapped to each index is its normalized
+// weight. A regular grid of uniform numbers checks this without statistical
+// fluctuations
+
+#include <vector>
+
+#include "globals.hh"
+#include "Randomize.hh"
+
+#include "RMGAliasTable.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  // fraction of a regular grid of n uniform numbers mapped to each index
+  std::vector<G4double> GridFrequencies(const RMGAliasTable& table, size_t n) {
+    std::vector<G4double> freq(table.size(), 0);
+    for (size_t i = 0; i < n; ++i) freq[table.Sample((i + 0.5) / n)] += 1. / n;
+    return freq;
+  }
+
+  void CheckDistribution(const std::vector<G4double>& weights) {
+
+    RMGAliasTable table;
+    table.Build(weights);
+    if (!RMG_CHECK(table.size() == weights.size())) return;
+
+    G4double total = 0;
+    for (auto w : weights) total += w;
+    RMG_CHECK_CLOSE(table.GetTotalWeight(), total, 1e-12);
+
+    // each grid point is off by at most one bin of width 1/n
+    const size_t n = 1000000;
+    auto freq = GridFrequencies(table, n);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      RMG_CHECK(std::abs(freq[i] - weights[i] / total) <= 2. * weights.size() / n);
+      if (weights[i] == 0) RMG_CHECK(freq[i] == 0);
+    }
+  }
+}
+
+int main() {
+
+  CheckDistribution({1});
+  CheckDistribution({1, 1, 1, 1});
+  CheckDistribution({1, 2, 3, 4, 5});
+  CheckDistribution({0, 3, 0, 1e-3, 7, 0});
+  CheckDistribution({1e6, 1, 1, 1, 1, 1, 1, 1});
+
+  std::vector<G4double> many;
+  for (size_t i = 0; i < 1000; ++i) many.push_back((i * 7919) % 101);
+  CheckDistribution(many);
+
+  // the ends of the unit interval stay in range
+  RMGAliasTable table;
+  table.Build({2, 1, 5});
+  RMG_CHECK(table.Sample(0.) < 3);
+  RMG_CHECK(table.Sample(1.) < 3);
+  RMG_CHECK(table.Sample(1. - 1e-16) < 3);
+
+  // draws with the engine follow the weights within statistical errors
+  G4Random::setTheSeed(1234);
+  std::vector<G4double> counts(3, 0);
+  const size_t n_draws = 800000;
+  for (size_t i = 0; i < n_draws; ++i) counts[table.Sample()] += 1;
+  RMG_CHECK(std::abs(counts[0] / n_draws - 0.25) < 5e-3);
+  RMG_CHECK(std::abs(counts[1] / n_draws - 0.125) < 5e-3);
+  RMG_CHECK(std::abs(counts[2] / n_draws - 0.625) < 5e-3);
+
+  table.clear();
+  RMG_CHECK(table.empty());
+  RMG_CHECK(table.GetTotalWeight() == 0);
+
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
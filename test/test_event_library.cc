@@ -0,0 +1,168 @@
+// Events written to an event library must be replayed unchanged: particles,
+// momenta, times and weights, the vertex being placed at replay time. The
+// replay starts at a random event, then walks the library in order and wraps
+// around at its end. Events seeded on their own start again at a random
+// event drawn with the event seed
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "RMGGeneratorPrimary.hh"
+#include "RMGGeneratorEventLibrary.hh"
+#include "RMGVGenerator.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  const char* kLibraryFile = "test_event_library.evl";
+  const size_t kNEvents = 50;
+
+  struct Track {
+    G4int         pdg_code;
+    G4ThreeVector momentum;
+    G4double      time;
+    G4ThreeVector position;
+  };
+
+  struct Event {
+    std::vector<Track> tracks;
+    G4double           weight;
+  };
+
+  // event number i has i % 4 tracks (none for some) at a time of i ns, the
+  // values are exact in single precision
+  Event MakeEvent(size_t i) {
+    Event event;
+    for (size_t j = 0; j < i % 4; ++j) {
+      event.tracks.push_back({j % 2 == 0 ? 11 : 22,
+          G4ThreeVector(0.25*i, -1.*j, 1.5)*MeV, 1.*i*ns, G4ThreeVector()});
+    }
+    event.weight = 1 + 0.5*i;
+    return event;
+  }
+
+  // event number of a replayed event, from its weight
+  long EventNumber(const Event& event) {
+    auto i = static_cast<long>((event.weight - 1) / 0.5 + 0.5);
+    return i >= 0 and static_cast<size_t>(i) < kNEvents ? i : -1;
+  }
+
+  class TestGenerator : public RMGVGenerator {
+
+    public:
+
+      TestGenerator() : RMGVGenerator("Test"), fNGenerated(0), fWeight(1) {}
+
+      void GeneratePrimaryVertex(G4Event* g4event) override {
+        auto event = MakeEvent(fNGenerated++);
+        fWeight = event.weight;
+        for (const auto& t : event.tracks) {
+          auto vertex = new G4PrimaryVertex(fPosition, t.time);
+          auto particle = t.pdg_code == 11 ? static_cast<G4ParticleDefinition*>(G4Electron::Definition())
+            : static_cast<G4ParticleDefinition*>(G4Gamma::Definition());
+          vertex->SetPrimary(new G4PrimaryParticle(particle, t.momentum.x(), t.momentum.y(), t.momentum.z()));
+          g4event->AddPrimaryVertex(vertex);
+        }
+      }
+      inline void SetParticlePosition(G4ThreeVector vec) override { fPosition = vec; }
+      inline G4double GetEventWeight() const override { return fWeight; }
+
+    private:
+
+      size_t        fNGenerated;
+      G4double      fWeight;
+      G4ThreeVector fPosition;
+  };
+
+  Event Replay(RMGGeneratorEventLibrary& library, const G4ThreeVector& position) {
+
+    library.SetParticlePosition(position);
+    G4Event g4event(0);
+    library.GeneratePrimaryVertex(&g4event);
+
+    Event event;
+    event.weight = library.GetEventWeight();
+    for (G4int v = 0; v < g4event.GetNumberOfPrimaryVertex(); ++v) {
+      auto vertex = g4event.GetPrimaryVertex(v);
+      for (auto p = vertex->GetPrimary(); p; p = p->GetNext()) {
+        event.tracks.push_back({p->GetPDGcode(), p->GetMomentum(), vertex->GetT0(), vertex->GetPosition()});
+      }
+    }
+    return event;
+  }
+
+  void CheckEvent(const Event& replayed, size_t i, const G4ThreeVector& position) {
+    auto expected = MakeEvent(i);
+    RMG_CHECK(replayed.weight == expected.weight);
+    if (!RMG_CHECK(replayed.tracks.size() == expected.tracks.size())) return;
+    for (size_t j = 0; j < expected.tracks.size(); ++j) {
+      RMG_CHECK(replayed.tracks[j].pdg_code == expected.tracks[j].pdg_code);
+      RMG_CHECK(replayed.tracks[j].momentum == expected.tracks[j].momentum);
+      RMG_CHECK(replayed.tracks[j].time == expected.tracks[j].time);
+      RMG_CHECK(replayed.tracks[j].position == position);
+    }
+  }
+}
+
+int main() {
+
+  G4Electron::Definition();
+  G4Gamma::Definition();
+  G4Random::setTheSeed(9012);
+
+  {
+    RMGGeneratorPrimary primary;
+    primary.SetGenerator(new TestGenerator());
+    primary.WriteEventLibrary(kLibraryFile, kNEvents);
+  }
+  RMG_CHECK(!std::ifstream(std::string(kLibraryFile) + ".tmp").good());
+
+  // replay twice the whole library, one event after the other
+  {
+    RMGGeneratorEventLibrary library(false);
+    library.SetFileName(kLibraryFile);
+
+    G4ThreeVector position(1*m, -2*m, 3*m);
+    auto first = Replay(library, position);
+    auto start = EventNumber(first);
+    if (RMG_CHECK(start >= 0)) {
+      CheckEvent(first, start, position);
+      for (size_t i = 1; i < 2*kNEvents + 1; ++i) {
+        CheckEvent(Replay(library, position), (start + i) % kNEvents, position);
+      }
+    }
+  }
+
+  // independent events: the event depends on the event seed only
+  {
+    RMGGeneratorEventLibrary library(false);
+    library.SetFileName(kLibraryFile);
+
+    std::vector<long> numbers;
+    for (long seed : {33, 44, 33}) {
+      G4Random::setTheSeed(seed);
+      library.PrepareIndependentEvent();
+      numbers.push_back(EventNumber(Replay(library, G4ThreeVector())));
+    }
+    RMG_CHECK(numbers[0] >= 0);
+    RMG_CHECK(numbers[0] == numbers[2]);
+  }
+
+  std::remove(kLibraryFile);
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,73 @@
+// Per-event seeding must make each event depend only on the base seed, the
+// run and the event number: seeding the same event again reproduces its
+// random stream whatever was drawn in between, and changing any of the three
+// inputs changes it
+
+#include <algorithm>
+#include <vector>
+
+#include "globals.hh"
+#include "Randomize.hh"
+
+#include "RMGManager.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  std::vector<G4double> Draw(size_t n = 16) {
+    std::vector<G4double> numbers(n);
+    for (auto& u : numbers) u = G4UniformRand();
+    return numbers;
+  }
+
+  std::vector<G4double> SeedAndDraw(const RMGManager& manager, G4int run_id, G4int event_id) {
+    manager.SeedEvent(run_id, event_id);
+    return Draw();
+  }
+}
+
+int main() {
+
+  RMGManager manager("test_event_seeding");
+  manager.SetBaseSeed(123456789);
+
+  // reproducible, whatever happened before
+  auto reference = SeedAndDraw(manager, 0, 5);
+  Draw(1000);
+  RMG_CHECK(SeedAndDraw(manager, 0, 5) == reference);
+  SeedAndDraw(manager, 3, 17);
+  RMG_CHECK(SeedAndDraw(manager, 0, 5) == reference);
+
+  // neighbouring events, runs and base seeds get unrelated streams
+  RMG_CHECK(SeedAndDraw(manager, 0, 4) != reference);
+  RMG_CHECK(SeedAndDraw(manager, 0, 6) != reference);
+  RMG_CHECK(SeedAndDraw(manager, 1, 5) != reference);
+  RMG_CHECK(SeedAndDraw(manager, 5, 0) != reference);
+  manager.SetBaseSeed(123456790);
+  RMG_CHECK(SeedAndDraw(manager, 0, 5) != reference);
+  manager.SetBaseSeed(123456789);
+  RMG_CHECK(SeedAndDraw(manager, 0, 5) == reference);
+
+  // no two of many consecutive events share their first number
+  std::vector<G4double> first;
+  for (G4int i = 0; i < 10000; ++i) first.push_back(SeedAndDraw(manager, 0, i)[0]);
+  std::sort(first.begin(), first.end());
+  RMG_CHECK(std::adjacent_find(first.begin(), first.end()) == first.end());
+
+  // the event number offset continues a previous job
+  manager.SetEventIDOffset(100);
+  auto with_offset = SeedAndDraw(manager, 0, 5);
+  manager.SetEventIDOffset(0);
+  RMG_CHECK(SeedAndDraw(manager, 0, 105) == with_offset);
+
+  // a fixed seeding run makes later runs replay the same events
+  manager.SetSeedingRunID(0);
+  RMG_CHECK(SeedAndDraw(manager, 7, 5) == reference);
+  manager.SetSeedingRunID(-1);
+  RMG_CHECK(SeedAndDraw(manager, 7, 5) != reference);
+
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
@@ -0,0 +1,94 @@
+// The MPMC queue must hand out every pushed element exactly once, in order
+// for a single producer and consumer, and refuse pushes when full and pops
+// when empty. Several producers and consumers then hammer a small queue
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "RMGMPMCQueue.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  void CheckSingleThread() {
+
+    RMGMPMCQueue<int> queue(5);
+    RMG_CHECK(queue.GetCapacity() == 8);
+
+    int value = -1;
+    RMG_CHECK(!queue.TryPop(value));
+
+    // fill it, wrap around a few times
+    int next_push = 0, next_pop = 0;
+    for (int round = 0; round < 5; ++round) {
+      while (queue.TryPush(int(next_push))) next_push++;
+      RMG_CHECK(next_push - next_pop == 8);
+      for (int i = 0; i < 3 + round; ++i) {
+        if (RMG_CHECK(queue.TryPop(value))) RMG_CHECK(value == next_pop);
+        next_pop++;
+      }
+    }
+    while (queue.TryPop(value)) RMG_CHECK(value == next_pop++);
+    RMG_CHECK(next_pop == next_push);
+
+    // move-only payloads
+    RMGMPMCQueue<std::unique_ptr<int>> ptr_queue(2);
+    RMG_CHECK(ptr_queue.TryPush(std::unique_ptr<int>(new int(42))));
+    std::unique_ptr<int> ptr;
+    if (RMG_CHECK(ptr_queue.TryPop(ptr))) RMG_CHECK(ptr and *ptr == 42);
+  }
+
+  void CheckManyThreads() {
+
+    const int n_producers = 4, n_consumers = 4, n_per_producer = 200000;
+    RMGMPMCQueue<int> queue(64);
+
+    std::vector<std::atomic<int>> seen(n_producers * n_per_producer);
+    for (auto& s : seen) s.store(0);
+    std::atomic<int> n_popped(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < n_producers; ++p) {
+      threads.emplace_back([&queue, p]() {
+        for (int i = 0; i < n_per_producer; ++i) {
+          int value = p * n_per_producer + i;
+          while (!queue.TryPush(int(value))) std::this_thread::yield();
+        }
+      });
+    }
+    for (int c = 0; c < n_consumers; ++c) {
+      threads.emplace_back([&]() {
+        int value;
+        while (n_popped.load() < n_producers * n_per_producer) {
+          if (queue.TryPop(value)) {
+            seen[value]++;
+            n_popped++;
+          }
+          else std::this_thread::yield();
+        }
+      });
+    }
+    for (auto& t : threads) t.join();
+
+    int n_wrong = 0;
+    for (const auto& s : seen) if (s.load() != 1) n_wrong++;
+    RMG_CHECK(n_wrong == 0);
+    RMG_CHECK(n_popped.load() == n_producers * n_per_producer);
+
+    int value;
+    RMG_CHECK(!queue.TryPop(value));
+  }
+}
+
+int main() {
+
+  CheckSingleThread();
+  CheckManyThreads();
+
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
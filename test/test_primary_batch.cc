@@ -0,0 +1,137 @@
+// Batched and per-event primary generation must produce the same events for
+// the same seed. The G4Gun generator draws no random numbers and the vertices
+// come from a vertex file (whose start is drawn at random), hence the random
+// stream is consumed in the same order by both paths. Momenta go through
+// G4PrimaryParticle as energy and direction on one path and as momentum on
+// the other, they agree up to rounding
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "globals.hh"
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4Electron.hh"
+#include "G4UImanager.hh"
+#include "Randomize.hh"
+
+#include "RMGGeneratorPrimary.hh"
+#include "RMGGeneratorG4Gun.hh"
+#include "RMGGeneratorVertexFile.hh"
+#include "RMGEventInformation.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  const char* kVertexFile = "test_primary_batch.vtx";
+  const size_t kNVertices = 1000;
+  const G4int kNEvents = 100;
+
+  struct Primary {
+    G4ThreeVector position;
+    G4double      t0;
+    const G4ParticleDefinition* particle;
+    G4ThreeVector momentum;
+    G4double      charge;
+    G4ThreeVector polarization;
+  };
+
+  struct Event {
+    std::vector<Primary> primaries;
+    G4double             weight;
+  };
+
+  void WriteVertexFile() {
+    RMGGeneratorVertexFile::VertexFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::strncpy(header.magic, RMGGeneratorVertexFile::kMagic, sizeof(header.magic));
+    header.version = RMGGeneratorVertexFile::kVersion;
+    header.record_size = 3*sizeof(G4double);
+    header.n_vertices = kNVertices;
+
+    std::ofstream file(kVertexFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (size_t i = 0; i < kNVertices; ++i) {
+      G4double v[3] = {1.*i, -2.*i, 0.5*i};
+      file.write(reinterpret_cast<const char*>(v), sizeof(v));
+    }
+  }
+
+  std::vector<Event> Generate(size_t batch_size) {
+
+    G4Random::setTheSeed(4242);
+
+    RMGGeneratorPrimary primary;
+    primary.SetConfinementCode(RMGGeneratorPrimary::kFromFile);
+    dynamic_cast<RMGGeneratorVertexFile*>(primary.GetPrimaryPositionGenerator())->SetFileName(kVertexFile);
+    primary.SetGenerator(new RMGGeneratorG4Gun());
+    primary.SetBatchSize(batch_size);
+
+    auto ui = G4UImanager::GetUIpointer();
+    ui->ApplyCommand("/gun/particle e-");
+    ui->ApplyCommand("/gun/energy 1.3 MeV");
+    ui->ApplyCommand("/gun/direction 0.3 -0.4 1");
+    ui->ApplyCommand("/gun/polarization 0 1 0");
+    ui->ApplyCommand("/gun/time 3 ns");
+    ui->ApplyCommand("/gun/number 2");
+
+    std::vector<Event> events;
+    for (G4int i = 0; i < kNEvents; ++i) {
+      G4Event g4event(i);
+      primary.GeneratePrimaries(&g4event);
+
+      Event event;
+      event.weight = RMGEventInformation::GetEventWeight(&g4event);
+      for (G4int v = 0; v < g4event.GetNumberOfPrimaryVertex(); ++v) {
+        auto vertex = g4event.GetPrimaryVertex(v);
+        for (auto p = vertex->GetPrimary(); p; p = p->GetNext()) {
+          event.primaries.push_back({vertex->GetPosition(), vertex->GetT0(), p->GetParticleDefinition(),
+              p->GetMomentum(), p->GetCharge(), p->GetPolarization()});
+        }
+      }
+      events.push_back(event);
+    }
+    return events;
+  }
+}
+
+int main() {
+
+  G4Electron::Definition();
+  WriteVertexFile();
+
+  auto reference = Generate(0);
+  for (size_t batch_size : {2, 7, 64, 1000}) {
+    auto batched = Generate(batch_size);
+    if (!RMG_CHECK(batched.size() == reference.size())) continue;
+
+    for (size_t i = 0; i < reference.size(); ++i) {
+      const auto& a = reference[i];
+      const auto& b = batched[i];
+      RMG_CHECK(a.weight == b.weight);
+      if (!RMG_CHECK(a.primaries.size() == b.primaries.size())) continue;
+
+      for (size_t j = 0; j < a.primaries.size(); ++j) {
+        const auto& p = a.primaries[j];
+        const auto& q = b.primaries[j];
+        RMG_CHECK(p.position == q.position);
+        RMG_CHECK(p.t0 == q.t0);
+        RMG_CHECK(p.particle == q.particle);
+        RMG_CHECK_CLOSE(p.momentum.x(), q.momentum.x(), 1e-12);
+        RMG_CHECK_CLOSE(p.momentum.y(), q.momentum.y(), 1e-12);
+        RMG_CHECK_CLOSE(p.momentum.z(), q.momentum.z(), 1e-12);
+        RMG_CHECK(p.charge == q.charge);
+        RMG_CHECK(p.polarization == q.polarization);
+      }
+    }
+  }
+
+  std::remove(kVertexFile);
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab
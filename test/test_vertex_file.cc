@@ -0,0 +1,120 @@
+// Vertices written by the confinement generator must come back unchanged
+// from the vertex file: the replay starts at a random vertex, then walks the
+// file in order and wraps around at its end. Events seeded on their own
+// start again at a random vertex drawn with the event seed
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include "RMGGeneratorVolumeConfinement.hh"
+#include "RMGGeneratorVertexFile.hh"
+
+#include "RMGTest.hh"
+
+namespace {
+
+  const char* kVertexFile = "test_vertex_file.vtx";
+  const size_t kNVertices = 777;
+
+  std::vector<G4ThreeVector> ReadVertexFile() {
+
+    std::vector<G4ThreeVector> vertices;
+    std::ifstream file(kVertexFile, std::ios::binary);
+    RMGGeneratorVertexFile::VertexFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!RMG_CHECK(file.good())) return vertices;
+
+    RMG_CHECK(std::strncmp(header.magic, RMGGeneratorVertexFile::kMagic, sizeof(header.magic)) == 0);
+    RMG_CHECK(header.version == RMGGeneratorVertexFile::kVersion);
+    RMG_CHECK(header.record_size == 3*sizeof(G4double));
+    RMG_CHECK(header.n_vertices == kNVertices);
+
+    G4double v[3];
+    while (file.read(reinterpret_cast<char*>(v), sizeof(v))) vertices.emplace_back(v[0], v[1], v[2]);
+    return vertices;
+  }
+
+  // index of the vertex in the file, -1 if not found
+  long Find(const std::vector<G4ThreeVector>& vertices, const G4ThreeVector& v) {
+    for (size_t i = 0; i < vertices.size(); ++i) if (vertices[i] == v) return i;
+    return -1;
+  }
+}
+
+int main() {
+
+  G4Random::setTheSeed(5678);
+
+  // write vertices sampled in a box
+  {
+    RMGGeneratorVolumeConfinement confinement(false);
+    RMGGeneratorVolumeConfinement::GenericGeometricalSolidData box;
+    box.g4_name = "Box";
+    box.volume_center = G4ThreeVector(1, 2, 3)*m;
+    box.box_x_length = 10*cm;
+    box.box_y_length = 20*cm;
+    box.box_z_length = 30*cm;
+    confinement.AddGeometricalVolume(box);
+    confinement.WriteVertexFile(kVertexFile, kNVertices);
+  }
+
+  auto written = ReadVertexFile();
+  if (!RMG_CHECK(written.size() == kNVertices)) return RMGTest::Result();
+  RMG_CHECK(!std::ifstream(std::string(kVertexFile) + ".tmp").good());
+
+  G4int n_outside = 0;
+  for (const auto& v : written) {
+    auto d = v - G4ThreeVector(1, 2, 3)*m;
+    if (std::abs(d.x()) > 5*cm or std::abs(d.y()) > 10*cm or std::abs(d.z()) > 15*cm) n_outside++;
+  }
+  RMG_CHECK(n_outside == 0);
+
+  // replay twice the whole file, one vertex after the other
+  {
+    RMGGeneratorVertexFile replay;
+    replay.SetFileName(kVertexFile);
+
+    auto start = Find(written, replay.NextPrimaryPosition());
+    if (RMG_CHECK(start >= 0)) {
+      G4int n_wrong = 0;
+      for (size_t i = 1; i < 2*kNVertices + 1; ++i) {
+        if (replay.NextPrimaryPosition() != written[(start + i) % kNVertices]) n_wrong++;
+      }
+      RMG_CHECK(n_wrong == 0);
+    }
+    RMG_CHECK(replay.GetVertexWeight() == 1);
+  }
+
+  // independent events: the start depends on the event seed only
+  {
+    RMGGeneratorVertexFile replay;
+    replay.SetFileName(kVertexFile);
+
+    std::vector<G4ThreeVector> first, second;
+    for (long seed : {11, 22, 11}) {
+      G4Random::setTheSeed(seed);
+      replay.PrepareIndependentEvent();
+      auto a = replay.NextPrimaryPosition();
+      auto b = replay.NextPrimaryPosition();
+      first.push_back(a);
+      second.push_back(b);
+
+      auto i = Find(written, a);
+      if (RMG_CHECK(i >= 0)) RMG_CHECK(b == written[(i + 1) % kNVertices]);
+    }
+    RMG_CHECK(first[0] == first[2]);
+    RMG_CHECK(second[0] == second[2]);
+  }
+
+  std::remove(kVertexFile);
+  return RMGTest::Result();
+}
+
+// vim: tabstop=2 shiftwidth=2 expandtab